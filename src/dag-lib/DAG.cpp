@@ -41,6 +41,11 @@ bool DAG::addEdge(int e1, int e2, int count)
     return _dagGraph.addEdge(e1,e2,count);
 }
 
+void DAG::setEdges(std::vector<uint64_t> &edges)
+{
+    _dagGraph.setEdges(edges);
+}
+
 bool DAG::rmEdge(int e1, int e2,int count)
 {
     return _dagGraph.rmEdge(e1,e2,count);
@@ -51,6 +56,11 @@ bool DAG::updateDAG(const DAG &dag)
     return _dagGraph.updateGraph(dag.getDagGraph());
 }
 
+bool DAG::tryUpdateDAG(const DAG &dag, DagGraph *added)
+{
+    return _dagGraph.tryUpdateGraph(dag.getDagGraph(), added);
+}
+
 bool DAG::rmUpdateDag(const DAG &dag)
 {
     return _dagGraph.rmUpdateGraph(dag.getDagGraph());
@@ -71,6 +81,21 @@ bool DAG::detectCycle() const
     return _dagGraph.detectCycle();
 }
 
+void DAG::freeze()
+{
+    _dagGraph.freeze();
+}
+
+void DAG::setBase(std::shared_ptr<const DagCSR> base)
+{
+    _dagGraph.setBase(base);
+}
+
+void DAG::swapGraph(DagGraph &dagGraph)
+{
+    _dagGraph.swap(dagGraph);
+}
+
 std::unordered_set<int> DAG::getVertices() const
 {
     return _dagGraph.getVertices();
@@ -107,8 +132,8 @@ void DAG::saveDAG(string rootFolder) const
     _dagGraph.saveGraph(filename);
 }
 
-void DAG::loadDAG(string rootFolder)
+bool DAG::loadDAG(string rootFolder)
 {
     string filename = getFilePath(rootFolder);
-    _dagGraph.loadGraph(filename);
+    return _dagGraph.loadGraph(filename);
 }
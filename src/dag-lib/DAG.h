@@ -24,11 +24,17 @@ public:
 
     bool find(int e1, int e2) const; // find edge
     bool addEdge(int e1, int e2, int count = 1);
+    void setEdges(std::vector<uint64_t> &edges); // packed edges, see DagCSR
     bool rmEdge(int e1, int e2, int count = 1);
     bool updateDAG(const DAG &dag);
+    // add dag unless that closes a cycle, see DagGraph::tryUpdateGraph
+    bool tryUpdateDAG(const DAG &dag, DagGraph *added = 0);
     bool rmUpdateDag(const DAG &dag);
 
     bool detectCycle() const;
+    void freeze(); // compact form for a dag that is only read from now on
+    void setBase(std::shared_ptr<const DagCSR> base); // see DagGraph::setBase
+    void swapGraph(DagGraph &dagGraph); // exchange edges with dagGraph, the id stays
 
     const DagGraph& getDagGraph() const;
 	unsigned int getEdgeSize() const;
@@ -39,7 +45,7 @@ public:
     // io
     int getId() const;
     void saveDAG(string rootFolder) const;
-    void loadDAG(string rootFolder);
+    bool loadDAG(string rootFolder);
 };
 
 #endif // DAG_H
@@ -1,5 +1,8 @@
 #include "DAGCenter.h"
 #include "Log.h"
+#include "DagCache.h"
+#include <algorithm>
+#include <cstdlib>
 
 #include <boost/filesystem.hpp>
 #include <fstream>
@@ -11,7 +14,8 @@ DAGCenter::DAGCenter(int nTris)
     ,_nTris(nTris)
     ,_nPointDags(-1)
     ,_numFailed(0)
-
+    ,_pageCache(0)
+    ,_maxResident(0)
 {
     _dags.clear();
     _pointDags.clear();
@@ -19,6 +23,7 @@ DAGCenter::DAGCenter(int nTris)
 
 DAGCenter::~DAGCenter()
 {
+    delete _pageCache;
 }
 
 void DAGCenter::initDags(int nDags)
@@ -46,22 +51,138 @@ DAG* DAGCenter::getPointDag(int id)
 
 const DAG* DAGCenter::getDag(int id) const
 {
-	return _dags[id];
+    if (!_pageCache)
+        return _dags[id];
+    std::lock_guard<std::mutex> guard(_pageLock);
+    return pageIn(id);
 }
 
 DAG* DAGCenter::getDag2(int id)
 {
+    if (!_pageCache)
+        return _dags[id];
+    std::lock_guard<std::mutex> guard(_pageLock);
+    // changes can't be paged out
+    _pinned[id] = 1;
+    return pageIn(id);
+}
+
+DAG* DAGCenter::pageIn(int id) const
+{
+    if (_dags[id]) {
+        _lru.splice(_lru.begin(), _lru, _lruPos[id]);
+        return _dags[id];
+    }
+    // an empty DAG would silently drop the occlusions of this view
+    auto graph = _pageCache->readGraph(id);
+    if (!graph) {
+        gLogFatal << "Failed to page in DAG " << id << ", the DAG cache is broken";
+        exit(-1);
+    }
+    _dags[id] = new DAG(id, _nTris);
+    _dags[id]->setBase(graph);
+    _lru.push_front(id);
+    _lruPos[id] = _lru.begin();
     return _dags[id];
 }
 
 void DAGCenter::cleanDag(int id)
 {
+    if (_pageCache) {
+        std::lock_guard<std::mutex> guard(_pageLock);
+        if (_dags[id])
+            _lru.erase(_lruPos[id]);
+        _pinned[id] = 0;
+    }
     if(_dags[id]){
        delete _dags[id];
        _dags[id] = nullptr;
     }
 }
 
+bool DAGCenter::page(string cacheFolder, size_t maxResident)
+{
+    auto cacheFile = getCacheFilePath(cacheFolder);
+    DagCache *cache = new DagCache();
+    if (!cache->open(cacheFile) || cache->getNumberOfTris() != _nTris) {
+        gLogError << "Failed to page DAGs from " << cacheFile;
+        delete cache;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(_pageLock);
+    // the dags in memory are the ones saved to the cache, they stay resident
+    // until trim() instead of being read again
+    if ((int)_dags.size() != cache->getNumberOfDags()) {
+        for (auto &dag : _dags) {
+            delete dag;
+            dag = 0;
+        }
+    }
+    delete _pageCache;
+    _pageCache = cache;
+    _maxResident = std::max<size_t>(1, maxResident);
+    _nDags = cache->getNumberOfDags();
+    _dags.resize(_nDags, 0);
+    _lru.clear();
+    _lruPos.assign(_nDags, _lru.end());
+    _pinned.assign(_nDags, 0);
+    for (int id = 0; id < _nDags; id++) {
+        if (_dags[id]) {
+            _lru.push_front(id);
+            _lruPos[id] = _lru.begin();
+        }
+    }
+    gLogInfo << "Paging " << _nDags << " DAGs from " << cacheFile
+             << ", at most " << _maxResident << " resident";
+    return true;
+}
+
+bool DAGCenter::isPaged() const
+{
+    return _pageCache != 0;
+}
+
+void DAGCenter::prefetch(const std::vector<int> &ids) const
+{
+    if (!_pageCache)
+        return;
+    std::lock_guard<std::mutex> guard(_pageLock);
+    // in reverse so the first ids end up most recent
+    for (auto it = ids.rbegin(); it != ids.rend(); ++it)
+        pageIn(*it);
+}
+
+void DAGCenter::trim()
+{
+    if (!_pageCache)
+        return;
+    std::lock_guard<std::mutex> guard(_pageLock);
+    auto it = _lru.end();
+    while (_lru.size() > _maxResident && it != _lru.begin()) {
+        --it;
+        int id = *it;
+        if (_pinned[id])
+            continue;
+        delete _dags[id];
+        _dags[id] = 0;
+        it = _lru.erase(it);
+    }
+}
+
+int DAGCenter::getNumberOfDags() const
+{
+    return _nDags;
+}
+
+void DAGCenter::cleanPointDag(int id)
+{
+    if(_pointDags[id]){
+        delete _pointDags[id];
+        _pointDags[id] = nullptr;
+    }
+}
+
 void DAGCenter::cleanPointDags()
 {
     for(int id =0; id < _nPointDags; id++){
@@ -78,20 +199,75 @@ string DAGCenter::getInitFilePath(string cacheFolder) const
     return fs::complete((dir / "index")).string();
 }
 
+string DAGCenter::getCacheFilePath(string cacheFolder) const
+{
+    fs::path dir(cacheFolder);
+    return fs::complete((dir / "dags.bin")).string();
+}
+
 bool DAGCenter::load(string cacheFolder)
 {
+    auto cacheFile = getCacheFilePath(cacheFolder);
+    if (!fs::exists(cacheFile)) {
+        // text files of one DAG each, written by older versions, counted in the index file
+        size_t nDags = 0;
+        std::ifstream fin(getInitFilePath(cacheFolder));
+        if (!(fin >> nDags) || nDags == 0) {
+            gLogError << "No DAG cache " << cacheFile << " and no index in " << cacheFolder;
+            return false;
+        }
+        for (auto dag : _dags)
+            delete dag;
+        _nDags = (int)nDags;
+        _dags.assign(nDags, 0);
+        for (size_t i = 0; i < nDags; ++i) {
+            _dags[i] = new DAG((int)i, _nTris);
+            if (!_dags[i]->loadDAG(cacheFolder)) {
+                gLogError << "No DAG cache " << cacheFile << " and no DAG files in " << cacheFolder;
+                for (auto &dag : _dags) {
+                    delete dag;
+                    dag = 0;
+                }
+                return false;
+            }
+        }
+        gLogInfo << "Loaded DAGs ";
+        return true;
+    }
+
+    DagCache cache;
+    if (!cache.open(cacheFile))
+        return false;
+    if (cache.getNumberOfTris() != _nTris) {
+        gLogError << "DAG cache " << cacheFile << " is for " << cache.getNumberOfTris()
+                  << " triangles, not " << _nTris;
+        return false;
+    }
+    for (auto dag : _dags)
+        delete dag;
+    _nDags = cache.getNumberOfDags();
+    _dags.assign(_nDags, 0);
     for (auto i = 0; i < _nDags; ++i) {
-        _dags[i] = new DAG(i, cacheFolder);
+        auto graph = cache.getGraph(i);
+        if (!graph) {
+            for (auto &dag : _dags) {
+                delete dag;
+                dag = 0;
+            }
+            return false;
+        }
+        _dags[i] = new DAG(i, _nTris);
+        _dags[i]->setBase(graph);
     }
-    gLogInfo << "Loaded DAGs ";
+    gLogInfo << "Loaded DAGs from " << cacheFile;
     return true;
 }
 
-void DAGCenter::save(string cacheFolder)
+bool DAGCenter::save(string cacheFolder)
 {
     if ( cacheFolder.empty() ) {
         gLogWarn << "No cache folder provided, skip saving!";
-        return;
+        return false;
     }
 
     //1. save nDags and nNodes to file
@@ -104,9 +280,12 @@ void DAGCenter::save(string cacheFolder)
     fout.close();
     gLogInfo << "Index file saved: " << filename;
 
-    //2. save individual Dag
-    for(const auto&dag: _dags) {
-        dag->saveDAG(cacheFolder);
-    }
+    //2. save all Dags
+    std::vector<const DagGraph*> graphs;
+    for(const auto&dag: _dags)
+        graphs.push_back(dag ? &dag->getDagGraph() : 0);
+    if (!DagCache::write(getCacheFilePath(cacheFolder), graphs, _nTris))
+        return false;
+    gLogInfo << "DAG cache saved: " << getCacheFilePath(cacheFolder);
+    return true;
 }
-
@@ -9,11 +9,23 @@
 #include <unordered_map>
 #include <map>
 #include <set>
+#include <list>
+#include <mutex>
+
+class DagCache;
+
 /*
  * Calculate and save DAGs for all views
  *
  * notes: For sampled view, we caculate DAG for viewpoint first
- *        and preclustering to generate DAG for sampled triangle
+ *        and preclustering to generate DAG for sampled triangle.
+ *        After page() the DAGs are read from the binary cache on demand and
+ *        at most maxResident of them are kept, least recently used first
+ *        out. Eviction only happens in trim(), so pointers from getDag stay
+ *        valid until then. DAGs from getDag2 may be changed and are never
+ *        evicted. Copies of a DAG share its edges, so the bound is on the
+ *        DAGs held here, not on memory: an evicted DAG is only freed once
+ *        no copy is left.
  */
 class TRIDAG_LIB DAGCenter
 {
@@ -22,14 +34,24 @@ class TRIDAG_LIB DAGCenter
     int                            _nPointDags;
     std::vector<DAG*>              _pointDags;
     int                            _nDags;
-    std::vector<DAG*>              _dags;
+    mutable std::vector<DAG*>      _dags; // null if paged out
 
     string                         _cacheFolder; // cache dir
     int                            _numFailed; //DAG with cycle
 
+    // paging, _pageCache is null when all dags are resident
+    DagCache                      *_pageCache;
+    size_t                         _maxResident;
+    mutable std::mutex             _pageLock;
+    mutable std::list<int>         _lru; // resident dags, most recent first
+    mutable std::vector<std::list<int>::iterator> _lruPos;
+    std::vector<char>              _pinned;
+
+    DAG* pageIn(int id) const; // under _pageLock, exits if the block of id is broken
 
 protected:
     std::string getInitFilePath( std::string cacheFolder ) const;
+    std::string getCacheFilePath( std::string cacheFolder ) const;
 public:
     DAGCenter( int nTris);
     ~DAGCenter();
@@ -44,10 +66,23 @@ public:
 
     // clean
     void cleanPointDags();
+    void cleanPointDag(int id);
     void cleanDag(int id);
 
-    bool load( std::string cacheFolder ); //load DAG from cacheDir
-    void save( std::string cacheFolder ); // save DAG to cacheDir
+    // load DAG from cacheDir, mapped from the binary cache or from the text files of older caches.
+    // false if neither can be read
+    bool load( std::string cacheFolder );
+    bool save( std::string cacheFolder ); // save DAG to the binary cache of cacheDir, false if it fails
+
+    // page DAGs from the binary cache of cacheDir, saved before. DAGs in memory
+    // must be the saved ones, they are kept until trim()
+    bool page( std::string cacheFolder, size_t maxResident );
+    bool isPaged() const;
+    // load dags now that will be used soon
+    void prefetch(const std::vector<int> &ids) const;
+    // evict least recently used dags down to maxResident
+    void trim();
+    int getNumberOfDags() const;
 };
 
 #endif // DAGCENTER_H
@@ -0,0 +1,315 @@
+#include "DagCSR.h"
+#include "Log.h"
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// an empty graph still has offsets[0]
+static const unsigned int EMPTY_OFFSETS[1] = {0};
+
+DagCSR::DagCSR()
+    :_numVertices(0)
+    ,_numEdges(0)
+    ,_offsets(EMPTY_OFFSETS)
+    ,_targets(0)
+    ,_counts(0)
+{
+}
+
+DagCSR::DagCSR(int numVertices, unsigned int numEdges, const unsigned int *offsets,
+               const int *targets, const int *counts, std::shared_ptr<const void> storage)
+    :_numVertices(numVertices)
+    ,_numEdges(numEdges)
+    ,_offsets(offsets)
+    ,_targets(targets)
+    ,_counts(counts)
+    ,_storage(storage)
+{
+}
+
+void DagCSR::attachData()
+{
+    _storage.reset();
+    _numEdges = (unsigned int)_targetData.size();
+    _offsets = _offsetData.empty() ? EMPTY_OFFSETS : _offsetData.data();
+    _targets = _targetData.data();
+    _counts = _countData.data();
+}
+
+void DagCSR::build(int numVertices, std::vector<uint64_t> &edges)
+{
+    std::sort(edges.begin(), edges.end());
+    // vertex ids may exceed numVertices for cluster graphs
+    if (!edges.empty())
+        numVertices = std::max(numVertices, edgeSource(edges.back()) + 1);
+
+    _numVertices = numVertices;
+    _offsetData.assign(numVertices + 1, 0);
+    _targetData.clear();
+    _countData.clear();
+    _targetData.reserve(edges.size());
+    _countData.reserve(edges.size());
+    for (size_t k = 0; k < edges.size(); ++k) {
+        if (k > 0 && edges[k] == edges[k - 1]) {
+            _countData.back()++;
+            continue;
+        }
+        _offsetData[edgeSource(edges[k]) + 1]++;
+        _targetData.push_back(edgeTarget(edges[k]));
+        _countData.push_back(1);
+    }
+    for (int v = 0; v < numVertices; ++v)
+        _offsetData[v + 1] += _offsetData[v];
+    _targetData.shrink_to_fit();
+    _countData.shrink_to_fit();
+    attachData();
+}
+
+void DagCSR::build(int numVertices, std::vector<std::pair<uint64_t, int>> &edges)
+{
+    std::sort(edges.begin(), edges.end());
+    if (!edges.empty())
+        numVertices = std::max(numVertices, edgeSource(edges.back().first) + 1);
+
+    _numVertices = numVertices;
+    _offsetData.assign(numVertices + 1, 0);
+    _targetData.clear();
+    _countData.clear();
+    _targetData.reserve(edges.size());
+    _countData.reserve(edges.size());
+    for (size_t k = 0; k < edges.size(); ++k) {
+        if (k > 0 && edges[k].first == edges[k - 1].first) {
+            _countData.back() += edges[k].second;
+            continue;
+        }
+        _offsetData[edgeSource(edges[k].first) + 1]++;
+        _targetData.push_back(edgeTarget(edges[k].first));
+        _countData.push_back(edges[k].second);
+    }
+    for (int v = 0; v < numVertices; ++v)
+        _offsetData[v + 1] += _offsetData[v];
+    _targetData.shrink_to_fit();
+    _countData.shrink_to_fit();
+    attachData();
+}
+
+void DagCSR::assign(int numVertices, unsigned int numEdges, const unsigned int *offsets,
+                    const int *targets, const int *counts)
+{
+    _numVertices = numVertices;
+    _offsetData.assign(offsets, offsets + numVertices + 1);
+    _targetData.assign(targets, targets + numEdges);
+    _countData.assign(counts, counts + numEdges);
+    attachData();
+}
+
+void DagCSR::clear()
+{
+    _numVertices = 0;
+    std::vector<unsigned int>().swap(_offsetData);
+    std::vector<int>().swap(_targetData);
+    std::vector<int>().swap(_countData);
+    attachData();
+}
+
+bool DagCSR::empty() const
+{
+    return _numEdges == 0;
+}
+
+int DagCSR::getNumberOfVertices() const
+{
+    return _numVertices;
+}
+
+unsigned int DagCSR::getEdgeSize() const
+{
+    return _numEdges;
+}
+
+size_t DagCSR::getMemorySize() const
+{
+    return _offsetData.size() * sizeof(unsigned int)
+            + (_targetData.size() + _countData.size()) * sizeof(int);
+}
+
+int DagCSR::find(int e1, int e2) const
+{
+    if (e1 < 0 || e1 >= _numVertices)
+        return 0;
+    const int *first = _targets + _offsets[e1];
+    const int *last = _targets + _offsets[e1 + 1];
+    const int *it = std::lower_bound(first, last, e2);
+    if (it == last || *it != e2)
+        return 0;
+    return _counts[it - _targets];
+}
+
+// iterative dfs, gray meets gray means a cycle
+bool DagCSR::detectCycle() const
+{
+    enum { white_color, gray_color, black_color };
+    int nColors = _numVertices;
+    for (unsigned int k = 0; k < _numEdges; ++k)
+        nColors = std::max(nColors, _targets[k] + 1);
+    std::vector<char> color(nColors, white_color);
+    // vertex and next edge to visit
+    std::vector<std::pair<int, unsigned int>> stack;
+    for (int root = 0; root < _numVertices; ++root) {
+        if (color[root] != white_color || rowBegin(root) == rowEnd(root))
+            continue;
+        color[root] = gray_color;
+        stack.push_back(std::make_pair(root, rowBegin(root)));
+        while (!stack.empty()) {
+            auto &top = stack.back();
+            if (top.second == rowEnd(top.first)) {
+                color[top.first] = black_color;
+                stack.pop_back();
+                continue;
+            }
+            int next = _targets[top.second++];
+            if (color[next] == gray_color)
+                return true;
+            if (color[next] == white_color) {
+                color[next] = gray_color;
+                if (next < _numVertices)
+                    stack.push_back(std::make_pair(next, rowBegin(next)));
+                else
+                    color[next] = black_color;
+            }
+        }
+    }
+    return false;
+}
+
+// a row this many times longer than the other one is searched, not merged
+static const unsigned int GALLOP_RATIO = 32;
+// rows at least this long with one target per BITMAP_DENSITY vertices use a bitmap
+static const unsigned int BITMAP_MIN_ROW = 64;
+static const unsigned int BITMAP_DENSITY = 64;
+
+// small row looked up in a much longer one, the search range only shrinks
+static unsigned int intersectGallop(const int *a, const int *aEnd, const int *b, const int *bEnd)
+{
+    unsigned int res = 0;
+    for (; a != aEnd && b != bEnd; ++a) {
+        // exponential search for *a, then binary search in the last step.
+        // steps are checked against the length left so no pointer passes bEnd
+        size_t step = 1;
+        const int *lo = b;
+        while (step < size_t(bEnd - lo) && lo[step] < *a) {
+            lo += step;
+            step <<= 1;
+        }
+        b = std::lower_bound(lo, lo + std::min(step + 1, size_t(bEnd - lo)), *a);
+        if (b != bEnd && *b == *a) {
+            ++res;
+            ++b;
+        }
+    }
+    return res;
+}
+
+// both rows are sorted without duplicates
+static unsigned int intersectMerge(const int *a, const int *aEnd, const int *b, const int *bEnd)
+{
+    unsigned int res = 0;
+#if defined(__AVX2__)
+    // compare 4x4 blocks, each value matches at most once
+    static const unsigned char popcount4[16] = {0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4};
+    while (aEnd - a >= 4 && bEnd - b >= 4) {
+        __m128i va = _mm_loadu_si128((const __m128i*)a);
+        __m128i vb = _mm_loadu_si128((const __m128i*)b);
+        __m128i eq = _mm_cmpeq_epi32(va, vb);
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0,3,2,1))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1,0,3,2))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2,1,0,3))));
+        res += popcount4[_mm_movemask_ps(_mm_castsi128_ps(eq))];
+        int aMax = a[3];
+        int bMax = b[3];
+        if (aMax <= bMax)
+            a += 4;
+        if (bMax <= aMax)
+            b += 4;
+    }
+#endif
+    while (a != aEnd && b != bEnd) {
+        if (*a < *b)
+            ++a;
+        else if (*b < *a)
+            ++b;
+        else {
+            ++res;
+            ++a;
+            ++b;
+        }
+    }
+    return res;
+}
+
+// shared edges per row, the method is picked by the lengths of the two rows
+unsigned int DagCSR::shareSize(const DagCSR &other) const
+{
+    unsigned int shareSize = 0;
+    int nRows = std::min(_numVertices, other._numVertices);
+    std::vector<uint64_t> bitmap; // allocated at the first dense row
+    for (int v = 0; v < nRows; ++v) {
+        const int *a = _targets + _offsets[v];
+        const int *aEnd = _targets + _offsets[v + 1];
+        const int *b = other._targets + other._offsets[v];
+        const int *bEnd = other._targets + other._offsets[v + 1];
+        unsigned int na = (unsigned int)(aEnd - a);
+        unsigned int nb = (unsigned int)(bEnd - b);
+        if (na == 0 || nb == 0)
+            continue;
+        if (na > nb) {
+            std::swap(a, b);
+            std::swap(aEnd, bEnd);
+            std::swap(na, nb);
+        }
+
+        if (nb >= GALLOP_RATIO * na) {
+            shareSize += intersectGallop(a, aEnd, b, bEnd);
+        }
+        else if (na >= BITMAP_MIN_ROW
+                 && (unsigned int)(bEnd[-1] - b[0]) <= BITMAP_DENSITY * nb) {
+            // dense rows, mark the longer row and probe the shorter one
+            int base = b[0];
+            size_t nWords = (size_t)(bEnd[-1] - base) / 64 + 1;
+            if (bitmap.size() < nWords)
+                bitmap.resize(nWords, 0);
+            for (const int *p = b; p != bEnd; ++p)
+                bitmap[(*p - base) >> 6] |= uint64_t(1) << ((*p - base) & 63);
+            for (const int *p = a; p != aEnd; ++p) {
+                int off = *p - base;
+                if (off >= 0 && (size_t)off < nWords * 64)
+                    shareSize += (unsigned int)((bitmap[off >> 6] >> (off & 63)) & 1);
+            }
+            std::fill(bitmap.begin(), bitmap.begin() + nWords, 0);
+        }
+        else {
+            shareSize += intersectMerge(a, aEnd, b, bEnd);
+        }
+    }
+    return shareSize;
+}
+
+void DagCSR::getVertices(std::vector<int> &vertices) const
+{
+    vertices.clear();
+    int nMarks = _numVertices;
+    for (unsigned int k = 0; k < _numEdges; ++k)
+        nMarks = std::max(nMarks, _targets[k] + 1);
+    std::vector<char> touched(nMarks, 0);
+    for (int v = 0; v < _numVertices; ++v) {
+        if (_offsets[v] == _offsets[v + 1])
+            continue;
+        touched[v] = 1;
+        for (auto k = _offsets[v]; k < _offsets[v + 1]; ++k)
+            touched[_targets[k]] = 1;
+    }
+    for (int v = 0; v < nMarks; ++v)
+        if (touched[v])
+            vertices.push_back(v);
+}
@@ -0,0 +1,130 @@
+#ifndef DAGCSR_H
+#define DAGCSR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <memory>
+#include "DLL.h"
+
+/*
+ * Immutable compressed sparse row form of a DAG
+ *
+ * notes: out edges of vertex v are _targets[_offsets[v].._offsets[v+1]),
+ *        sorted by target, with the edge counts in _counts at the same
+ *        positions. Built once from a flat edge list or from the map form of
+ *        DagGraph, so read only graphs don't pay a hash node per edge and
+ *        are scanned sequentially. The arrays are either owned or a view of
+ *        external memory (a mapped DagCache file) kept alive by _storage.
+ */
+class TRIDAG_LIB DagCSR
+{
+    int                         _numVertices;
+    unsigned int                _numEdges;
+    const unsigned int         *_offsets;   // numVertices+1 entries
+    const int                  *_targets;
+    const int                  *_counts;
+
+    std::vector<unsigned int>   _offsetData; // owned arrays, empty for a view
+    std::vector<int>            _targetData;
+    std::vector<int>            _countData;
+    std::shared_ptr<const void> _storage;
+
+    DagCSR(const DagCSR&);
+    DagCSR& operator=(const DagCSR&);
+    void attachData(); // point the arrays to the owned data
+
+public:
+    DagCSR();
+    // view of external arrays, storage keeps them alive
+    DagCSR(int numVertices, unsigned int numEdges, const unsigned int *offsets,
+           const int *targets, const int *counts, std::shared_ptr<const void> storage);
+    // owned copy of the arrays
+    void assign(int numVertices, unsigned int numEdges, const unsigned int *offsets,
+                const int *targets, const int *counts);
+
+    // edge e1->e2 packed to sort by e1 then e2
+    static inline uint64_t packEdge(int e1, int e2);
+    static inline int edgeSource(uint64_t packed);
+    static inline int edgeTarget(uint64_t packed);
+
+    // edges are sorted in place, duplicated edges are merged into counts
+    void build(int numVertices, std::vector<uint64_t> &edges);
+    // same with an explicit count per edge
+    void build(int numVertices, std::vector<std::pair<uint64_t, int>> &edges);
+    void clear();
+
+    bool empty() const;
+    int getNumberOfVertices() const;
+    unsigned int getEdgeSize() const;
+    size_t getMemorySize() const; // in bytes, 0 for a view
+    const unsigned int* getOffsets() const;
+    const int* getTargets() const;
+    const int* getCounts() const;
+
+    inline unsigned int rowBegin(int v) const;
+    inline unsigned int rowEnd(int v) const;
+    inline int target(unsigned int k) const;
+    inline int count(unsigned int k) const;
+
+    // count of e1->e2, 0 if absent
+    int find(int e1, int e2) const;
+    bool detectCycle() const;
+    // number of edges found in both graphs
+    unsigned int shareSize(const DagCSR &other) const;
+    // sorted ids of vertices touched by any edge
+    void getVertices(std::vector<int> &vertices) const;
+};
+
+inline uint64_t DagCSR::packEdge(int e1, int e2)
+{
+    return ((uint64_t)(uint32_t)e1 << 32) | (uint32_t)e2;
+}
+
+inline int DagCSR::edgeSource(uint64_t packed)
+{
+    return (int)(uint32_t)(packed >> 32);
+}
+
+inline int DagCSR::edgeTarget(uint64_t packed)
+{
+    return (int)(uint32_t)packed;
+}
+
+inline const unsigned int* DagCSR::getOffsets() const
+{
+    return _offsets;
+}
+
+inline const int* DagCSR::getTargets() const
+{
+    return _targets;
+}
+
+inline const int* DagCSR::getCounts() const
+{
+    return _counts;
+}
+
+inline unsigned int DagCSR::rowBegin(int v) const
+{
+    return _offsets[v];
+}
+
+inline unsigned int DagCSR::rowEnd(int v) const
+{
+    return _offsets[v + 1];
+}
+
+inline int DagCSR::target(unsigned int k) const
+{
+    return _targets[k];
+}
+
+inline int DagCSR::count(unsigned int k) const
+{
+    return _counts[k];
+}
+
+#endif // DAGCSR_H
@@ -0,0 +1,213 @@
+#include "DagCache.h"
+#include "Log.h"
+#include <fstream>
+#include <cstring>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace bip = boost::interprocess;
+
+// file and region are unmapped together
+struct DagCacheMapping
+{
+    bip::file_mapping   file;
+    bip::mapped_region  region;
+};
+
+static uint64_t alignUp(uint64_t size)
+{
+    return (size + 7) & ~uint64_t(7);
+}
+
+static uint64_t blockSize(uint32_t numVertices, uint32_t numEdges)
+{
+    return alignUp((uint64_t)(numVertices + 1) * sizeof(uint32_t)
+                   + 2 * (uint64_t)numEdges * sizeof(int32_t));
+}
+
+DagCache::DagCache()
+    :_data(0)
+    ,_size(0)
+    ,_header(0)
+    ,_index(0)
+{
+}
+
+// FNV-1a over 8 byte words, sizes are multiples of 8
+uint64_t DagCache::checksum(const void *data, size_t size, uint64_t seed)
+{
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = seed ? seed : 0xcbf29ce484222325ULL;
+    const char *p = static_cast<const char*>(data);
+    for (size_t k = 0; k + 8 <= size; k += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + k, 8);
+        hash = (hash ^ word) * prime;
+    }
+    return hash;
+}
+
+bool DagCache::write(const std::string &fileName, const std::vector<const DagGraph*> &graphs, int nTris)
+{
+    std::ofstream ofs(fileName, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        gLogError << "Failed to open DAG cache " << fileName;
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.nDags = (uint32_t)graphs.size();
+    header.nTris = (uint32_t)nTris;
+
+    // blocks follow the index, placeholders are written first
+    std::vector<IndexEntry> index(graphs.size());
+    std::memset(index.data(), 0, index.size() * sizeof(IndexEntry));
+    ofs.write((const char*)&header, sizeof(header));
+    ofs.write((const char*)index.data(), index.size() * sizeof(IndexEntry));
+
+    uint64_t offset = sizeof(Header) + index.size() * sizeof(IndexEntry);
+    std::vector<char> block;
+    for (size_t i = 0; i < graphs.size(); ++i) {
+        std::shared_ptr<const DagCSR> csr;
+        if (graphs[i])
+            csr = graphs[i]->getCSR();
+        uint32_t numVertices = csr ? (uint32_t)csr->getNumberOfVertices() : 0;
+        uint32_t numEdges = csr ? csr->getEdgeSize() : 0;
+
+        block.assign(blockSize(numVertices, numEdges), 0);
+        char *p = block.data();
+        if (csr) {
+            std::memcpy(p, csr->getOffsets(), (numVertices + 1) * sizeof(uint32_t));
+            p += (numVertices + 1) * sizeof(uint32_t);
+            std::memcpy(p, csr->getTargets(), numEdges * sizeof(int32_t));
+            p += numEdges * sizeof(int32_t);
+            std::memcpy(p, csr->getCounts(), numEdges * sizeof(int32_t));
+        }
+        // an empty block still has offsets[0] = 0
+
+        index[i].offset = offset;
+        index[i].numVertices = numVertices;
+        index[i].numEdges = numEdges;
+        index[i].checksum = checksum(block.data(), block.size());
+        ofs.write(block.data(), block.size());
+        offset += block.size();
+    }
+
+    header.fileSize = offset;
+    header.checksum = checksum(index.data(), index.size() * sizeof(IndexEntry),
+                               checksum(&header, sizeof(header)));
+    ofs.seekp(0);
+    ofs.write((const char*)&header, sizeof(header));
+    ofs.write((const char*)index.data(), index.size() * sizeof(IndexEntry));
+    ofs.close();
+    if (!ofs) {
+        gLogError << "Failed to write DAG cache " << fileName;
+        return false;
+    }
+    return true;
+}
+
+bool DagCache::open(const std::string &fileName)
+{
+    close();
+    std::shared_ptr<DagCacheMapping> mapping;
+    try {
+        mapping = std::make_shared<DagCacheMapping>();
+        mapping->file = bip::file_mapping(fileName.c_str(), bip::read_only);
+        mapping->region = bip::mapped_region(mapping->file, bip::read_only);
+    }
+    catch (std::exception &ex) {
+        gLogError << "Failed to map DAG cache " << fileName << " - " << ex.what();
+        return false;
+    }
+
+    const char *data = static_cast<const char*>(mapping->region.get_address());
+    size_t size = mapping->region.get_size();
+    if (size < sizeof(Header)) {
+        gLogError << "DAG cache " << fileName << " is truncated";
+        return false;
+    }
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION) {
+        gLogError << "DAG cache " << fileName << " has unknown version " << header.version;
+        return false;
+    }
+    uint64_t indexSize = (uint64_t)header.nDags * sizeof(IndexEntry);
+    if (header.fileSize != size || sizeof(Header) + indexSize > size) {
+        gLogError << "DAG cache " << fileName << " is truncated";
+        return false;
+    }
+    uint64_t sum = header.checksum;
+    header.checksum = 0;
+    if (checksum(data + sizeof(Header), indexSize, checksum(&header, sizeof(header))) != sum) {
+        gLogError << "DAG cache " << fileName << " has a broken index";
+        return false;
+    }
+
+    _mapping = mapping;
+    _data = data;
+    _size = size;
+    _header = reinterpret_cast<const Header*>(data);
+    _index = reinterpret_cast<const IndexEntry*>(data + sizeof(Header));
+    return true;
+}
+
+void DagCache::close()
+{
+    _mapping.reset();
+    _data = 0;
+    _size = 0;
+    _header = 0;
+    _index = 0;
+}
+
+int DagCache::getNumberOfDags() const
+{
+    return _header ? (int)_header->nDags : 0;
+}
+
+int DagCache::getNumberOfTris() const
+{
+    return _header ? (int)_header->nTris : 0;
+}
+
+std::shared_ptr<const DagCSR> DagCache::getGraph(int id, bool verify) const
+{
+    if (id < 0 || id >= getNumberOfDags())
+        return std::shared_ptr<const DagCSR>();
+    const IndexEntry &entry = _index[id];
+    uint64_t size = blockSize(entry.numVertices, entry.numEdges);
+    if (entry.offset % 8 != 0 || entry.offset + size > _size) {
+        gLogError << "DAG " << id << " is out of the cache";
+        return std::shared_ptr<const DagCSR>();
+    }
+    const char *block = _data + entry.offset;
+    if (verify && checksum(block, size) != entry.checksum) {
+        gLogError << "DAG " << id << " has a broken block";
+        return std::shared_ptr<const DagCSR>();
+    }
+
+    auto offsets = reinterpret_cast<const unsigned int*>(block);
+    auto targets = reinterpret_cast<const int*>(block + (entry.numVertices + 1) * sizeof(uint32_t));
+    auto counts = targets + entry.numEdges;
+    if (offsets[entry.numVertices] != entry.numEdges) {
+        gLogError << "DAG " << id << " has a broken block";
+        return std::shared_ptr<const DagCSR>();
+    }
+    return std::make_shared<DagCSR>(entry.numVertices, entry.numEdges, offsets, targets, counts, _mapping);
+}
+
+std::shared_ptr<const DagCSR> DagCache::readGraph(int id, bool verify) const
+{
+    auto view = getGraph(id, verify);
+    if (!view)
+        return view;
+    auto graph = std::make_shared<DagCSR>();
+    graph->assign(view->getNumberOfVertices(), view->getEdgeSize(),
+                  view->getOffsets(), view->getTargets(), view->getCounts());
+    return graph;
+}
@@ -0,0 +1,71 @@
+#ifndef DAGCACHE_H
+#define DAGCACHE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+#include "DLL.h"
+#include "DagGraph.h"
+
+/*
+ * Binary container of all view DAGs of a cache dir
+ *
+ * notes: layout is a header, an index with one entry per DAG and the DAGs
+ *        as CSR blocks (offsets, targets, counts), all 8 byte aligned and
+ *        little endian. The header holds a checksum of header and index,
+ *        each index entry a checksum of its block. The file is memory
+ *        mapped and DAGs are views of the mapping, the mapping lives as
+ *        long as any of them.
+ */
+class TRIDAG_LIB DagCache
+{
+public:
+    static const uint32_t MAGIC = 0x47414454; // "TDAG"
+    static const uint32_t VERSION = 1;
+
+    struct Header
+    {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    nDags;
+        uint32_t    nTris;
+        uint64_t    fileSize;
+        uint64_t    checksum; // of header with checksum 0 and index
+    };
+
+    struct IndexEntry
+    {
+        uint64_t    offset; // of the block from the file start
+        uint32_t    numVertices; // rows of the block
+        uint32_t    numEdges;
+        uint64_t    checksum; // of the block
+    };
+
+private:
+    std::shared_ptr<const void>     _mapping;
+    const char                     *_data;
+    size_t                          _size;
+    const Header                   *_header;
+    const IndexEntry               *_index;
+
+public:
+    DagCache();
+
+    // null graphs are saved empty, false if the file can't be written
+    static bool write(const std::string &fileName, const std::vector<const DagGraph*> &graphs, int nTris);
+    static uint64_t checksum(const void *data, size_t size, uint64_t seed = 0);
+
+    // map the file and check header and index, false if it is not a valid cache
+    bool open(const std::string &fileName);
+    void close();
+
+    int getNumberOfDags() const;
+    int getNumberOfTris() const;
+    // view of DAG id, null if its block is broken
+    std::shared_ptr<const DagCSR> getGraph(int id, bool verify = true) const;
+    // owned copy of DAG id, the mapped pages can be dropped after
+    std::shared_ptr<const DagCSR> readGraph(int id, bool verify = true) const;
+};
+
+#endif // DAGCACHE_H
@@ -5,6 +5,7 @@
 #include <boost/archive/text_iarchive.hpp>
 #include<boost/archive/text_oarchive.hpp>
 #include <fstream>
+#include <algorithm>
 
 float loadFactor = 16.0;
 class viewSort{
@@ -32,7 +33,11 @@ DagGraph::DagGraph(int nVertices)
 }
 
 DagGraph::DagGraph(const DagGraph& dagGraph)
-    :_edgeSize(dagGraph._edgeSize)
+    :_base(dagGraph._base)
+    ,_baseDelta(dagGraph._baseDelta)
+    ,_ord(dagGraph._ord)
+    ,_ordVertex(dagGraph._ordVertex)
+    ,_edgeSize(dagGraph._edgeSize)
     ,_numVertices(dagGraph._numVertices)
 {
     _dagMap.max_load_factor(loadFactor);
@@ -44,7 +49,7 @@ DagGraph::DagGraph(const DagGraph& dagGraph)
         auto size2 = map.at(it->first).size();
         bool hasReserve = false;
         for(auto innerIt = map.at(it->first).cbegin();innerIt != map.at(it->first).cend();innerIt++){
-            this->addEdge(it->first,innerIt->first,innerIt->second);
+            this->insertEdge(it->first,innerIt->first,innerIt->second);
             if(!hasReserve){
                _dagMap.at(it->first).max_load_factor(loadFactor);
                _dagMap.at(it->first).reserve((int)size2/(int)loadFactor +1);
@@ -52,19 +57,44 @@ DagGraph::DagGraph(const DagGraph& dagGraph)
             }
         }
     }
+    _edgeSize = dagGraph._edgeSize;
 }
 
 bool DagGraph::find(int e1, int e2) const
 {
-    if (_dagMap.find(e1) == _dagMap.end())
+    int count = baseCount(e1, e2);
+    if (count > 0)
+        return count + baseDelta(e1, e2) > 0;
+    auto it = _dagMap.find(e1);
+    if (it == _dagMap.end())
         return false;
-    if (_dagMap.at(e1).find(e2) == _dagMap.at(e1).end())
+    if (it->second.find(e2) == it->second.end())
         return false;
     return true;
 }
 
 bool DagGraph::addEdge(int e1, int e2, int count)
 {
+    // may break the topological order
+    _ord.clear();
+    _ordVertex.clear();
+    return insertEdge(e1, e2, count);
+}
+
+bool DagGraph::insertEdge(int e1, int e2, int count)
+{
+    int inBase = baseCount(e1, e2);
+    if (inBase > 0) {
+        // base edges only change their count
+        auto key = DagCSR::packEdge(e1, e2);
+        int &delta = _baseDelta[key];
+        if (inBase + delta == 0)
+            _edgeSize++;
+        delta += count;
+        if (delta == 0)
+            _baseDelta.erase(key);
+        return true;
+    }
     try{
     if (this->find(e1, e2)){
         _dagMap[e1][e2] += count;
@@ -86,6 +116,27 @@ bool DagGraph::addEdge(int e1, int e2, int count)
 
 bool DagGraph::rmEdge(int e1, int e2, int count)
 {
+    int inBase = baseCount(e1, e2);
+    if (inBase > 0) {
+        auto key = DagCSR::packEdge(e1, e2);
+        int delta = baseDelta(e1, e2);
+        if (inBase + delta == 0) {
+            gLogError<< "Not find!";
+            return false;
+        }
+        if (inBase + delta < count) {
+            gLogError << "edge count less than rm, please check!";
+            return false;
+        }
+        delta -= count;
+        if (delta == 0)
+            _baseDelta.erase(key);
+        else
+            _baseDelta[key] = delta;
+        if (inBase + delta == 0)
+            _edgeSize--;
+        return true;
+    }
     if (!this->find(e1, e2)){
         gLogError<< "Not find!";
         return false;
@@ -108,67 +159,207 @@ bool DagGraph::rmEdge(int e1, int e2, int count)
 
 bool DagGraph::updateGraph(const DagGraph &dagGraph)
 {
-    const auto& dagMap = dagGraph._dagMap;
-    for(auto it = dagMap.cbegin();it!= dagMap.cend(); it++){
-        for(auto it2 = it->second.cbegin();it2!= it->second.cend();it2++){
-            this->addEdge(it->first,it2->first, it2->second);
+    dagGraph.forEachEdge([this](int e1, int e2, int count) {
+        this->addEdge(e1, e2, count);
+        return true;
+    });
+    return !this->detectCycle();
+}
+
+bool DagGraph::tryUpdateGraph(const DagGraph &dagGraph, DagGraph *added)
+{
+    if (_ord.empty() && !buildOrder()) {
+        gLogError << "graph has a cycle before update, please check";
+        return false;
+    }
+
+    // inserted edges and changed order windows, reverted on a cycle
+    std::vector<std::pair<Edge, int>> inserted;
+    std::vector<std::pair<int, std::vector<int>>> undo;
+    std::vector<char> visited(_ord.size(), 0);
+    bool acyclic = dagGraph.forEachEdge([&](int e1, int e2, int count) {
+        if (!find(e1, e2)) {
+            if (!orderEdge(e1, e2, visited, undo))
+                return false;
+            if (added)
+                added->addEdge(e1, e2);
+        }
+        insertEdge(e1, e2, count);
+        inserted.push_back(std::make_pair(Edge(e1, e2), count));
+        return true;
+    });
+    if (acyclic) {
+        // fold changes into a new base once they outgrow the shared one
+        if (_base && (_edgeSize > 2 * _base->getEdgeSize()
+                      || _baseDelta.size() > _base->getEdgeSize() / 2))
+            freeze();
+        return true;
+    }
+
+    for (auto it = inserted.rbegin(); it != inserted.rend(); ++it)
+        rmEdge(it->first.first, it->first.second, it->second);
+    for (auto it = undo.rbegin(); it != undo.rend(); ++it) {
+        for (size_t k = 0; k < it->second.size(); ++k) {
+            int v = it->second[k];
+            _ordVertex[it->first + k] = v;
+            _ord[v] = it->first + (int)k;
         }
     }
-    return !this->detectCycle();
+    if (added)
+        added->clear();
+    return false;
 }
 
-bool DagGraph::rmUpdateGraph(const DagGraph &dagGraph)
+// Kahn's algorithm over all vertices
+bool DagGraph::buildOrder()
 {
-    const auto& dagMap = dagGraph._dagMap;
-    for(auto it = dagMap.cbegin();it!= dagMap.cend();it++){
-        for(auto innerIt =it->second.cbegin();innerIt != it->second.cend();innerIt++){
-            if(!this->rmEdge(it->first,innerIt->first,innerIt->second)){
-                gLogInfo<<"remove edge wrong: "<<it->first<<" -- "<<innerIt->first<<" count "<<innerIt->second;
+    int n = (int)_numVertices;
+    forEachEdge([&n](int e1, int e2, int) {
+        n = std::max(n, std::max(e1, e2) + 1);
+        return true;
+    });
+    std::vector<int> inDegree(n, 0);
+    forEachEdge([&inDegree](int, int e2, int) {
+        inDegree[e2]++;
+        return true;
+    });
+    _ordVertex.clear();
+    _ordVertex.reserve(n);
+    for (int v = 0; v < n; ++v)
+        if (inDegree[v] == 0)
+            _ordVertex.push_back(v);
+    for (size_t k = 0; k < _ordVertex.size(); ++k) {
+        forEachOut(_ordVertex[k], [this, &inDegree](int w) {
+            if (--inDegree[w] == 0)
+                _ordVertex.push_back(w);
+            return true;
+        });
+    }
+    if ((int)_ordVertex.size() != n) {
+        _ordVertex.clear();
+        return false;
+    }
+    _ord.assign(n, 0);
+    for (int k = 0; k < n; ++k)
+        _ord[_ordVertex[k]] = k;
+    return true;
+}
+
+// vertices reachable from e2 inside the window [ord e2, ord e1] are moved
+// behind the rest of the window, reaching e1 means a cycle
+bool DagGraph::orderEdge(int e1, int e2, std::vector<char> &visited,
+                         std::vector<std::pair<int, std::vector<int>>> &undo)
+{
+    if (e1 == e2)
+        return false;
+    int n = std::max(e1, e2) + 1;
+    if (n > (int)_ord.size()) {
+        // unseen vertices go to the end of the order
+        for (int v = (int)_ord.size(); v < n; ++v) {
+            _ord.push_back((int)_ordVertex.size());
+            _ordVertex.push_back(v);
+        }
+        visited.resize(n, 0);
+    }
+    int lb = _ord[e2];
+    int ub = _ord[e1];
+    if (lb > ub)
+        return true;
+
+    std::vector<int> reached;
+    std::vector<int> stack{e2};
+    visited[e2] = 1;
+    bool cycle = false;
+    while (!stack.empty() && !cycle) {
+        int v = stack.back();
+        stack.pop_back();
+        reached.push_back(v);
+        cycle = !forEachOut(v, [&](int w) {
+            if (w == e1)
                 return false;
+            if (!visited[w] && _ord[w] < ub) {
+                visited[w] = 1;
+                stack.push_back(w);
             }
+            return true;
+        });
+    }
+    if (cycle) {
+        for (auto v : stack)
+            visited[v] = 0;
+        for (auto v : reached)
+            visited[v] = 0;
+        return false;
+    }
 
-        }
+    // reached vertices keep their relative order after the others
+    std::vector<int> window(_ordVertex.begin() + lb, _ordVertex.begin() + ub + 1);
+    std::sort(reached.begin(), reached.end(), [this](int a, int b) { return _ord[a] < _ord[b]; });
+    int pos = lb;
+    for (auto v : window)
+        if (!visited[v])
+            _ordVertex[pos++] = v;
+    for (auto v : reached) {
+        _ordVertex[pos++] = v;
+        visited[v] = 0;
     }
+    for (int k = lb; k <= ub; ++k)
+        _ord[_ordVertex[k]] = k;
+    undo.push_back(std::make_pair(lb, window));
     return true;
 }
 
+bool DagGraph::rmUpdateGraph(const DagGraph &dagGraph)
+{
+    return dagGraph.forEachEdge([this](int e1, int e2, int count) {
+        if(!this->rmEdge(e1, e2, count)){
+            gLogInfo<<"remove edge wrong: "<<e1<<" -- "<<e2<<" count "<<count;
+            return false;
+        }
+        return true;
+    });
+}
+
 void DagGraph::minusInter(const DagGraph& keepGraph, const DagGraph& rmGraph)
 {
-	const auto& keep = keepGraph._dagMap;
-	const auto& rm = rmGraph._dagMap;
-	for (auto it = keep.cbegin(); it != keep.cend(); it++) {
-		for (auto innerIt = keep.at(it->first).cbegin(); innerIt != keep.at(it->first).cend(); innerIt++) {
-			// find if this edge is in or not
-			if (rm.find(it->first) == rm.end()) {
-				this->addEdge(it->first, innerIt->first);
-			}
-			else if (rm.at(it->first).find(innerIt->first) == rm.at(it->first).end()) {
-				this->addEdge(it->first, innerIt->first);
-			}
-		}
-	}
+	keepGraph.forEachEdge([this, &rmGraph](int e1, int e2, int) {
+		// find if this edge is in or not
+		if (!rmGraph.find(e1, e2))
+			this->addEdge(e1, e2);
+		return true;
+	});
 }
 
 unsigned int DagGraph::shareSize(const DagGraph& dag) const
 {
-    const auto& dagMap = dag._dagMap;
+    if (isCompact() && dag.isCompact())
+        return _base->shareSize(*dag._base);
+
+    // shared edges are symmetric, walk the smaller graph row by row
+    const DagGraph &small = getEdgeSize() <= dag.getEdgeSize() ? *this : dag;
+    const DagGraph &large = &small == this ? dag : *this;
     unsigned int shareSize = 0;
-    try {
-        for (auto it = _dagMap.cbegin(); it != _dagMap.cend(); it++) {
-            if (dagMap.find(it->first) == dagMap.end())
-                continue;
-            for (auto innerIt = it->second.cbegin(); innerIt != it->second.cend(); innerIt++) {
-                // at might have some problem
-                if (dagMap.at(it->first).find(innerIt->first) != dagMap.at(it->first).end())
-                    shareSize++;
-            }
-        }
-    }
-    catch (const std::out_of_range& oor) {
-        std::cerr << "Out of Range errorL " << oor.what() << '\n';
-        std::cout << "please check" << std::endl;
+    if (large._base) {
+        small.forEachEdge([&large, &shareSize](int e1, int e2, int) {
+            if (large.find(e1, e2))
+                shareSize++;
+            return true;
+        });
+        return shareSize;
     }
-
+    // one hash lookup per row of the small graph, one per edge
+    int lastRow = -1;
+    const std::unordered_map<int,int> *row = 0;
+    small.forEachEdge([&](int e1, int e2, int) {
+        if (e1 != lastRow) {
+            lastRow = e1;
+            auto it = large._dagMap.find(e1);
+            row = it == large._dagMap.end() ? 0 : &it->second;
+        }
+        if (row && row->find(e2) != row->end())
+            shareSize++;
+        return true;
+    });
     return shareSize;
 }
 
@@ -180,38 +371,31 @@ unsigned int DagGraph::shareSize(const DagGraph& dag) const
 bool DagGraph::has_cycle_dfs(int vId, default_color_type* color) const
 {
     color[vId] = gray_color;
-    try{
-        if (_dagMap.find(vId) == _dagMap.end()){
-            color[vId] = black_color;
-            return false;
-        }
-        auto adjVertices = _dagMap.at(vId);
-        for (auto it = adjVertices.cbegin(); it != adjVertices.cend(); it++){
-            if (color[it->first] == white_color){
-                if (has_cycle_dfs(it->first, color))
-                    return true;
-            }
-            else if (color[it->first] == gray_color)
-                return true;
-        }
+    bool cycle = !forEachOut(vId, [this, color](int w) {
+        if (color[w] == white_color)
+            return !has_cycle_dfs(w, color);
+        return color[w] != gray_color;
+    });
+    if (!cycle)
         color[vId] = black_color;
-        return false;
-    }
-    catch (const std::out_of_range& oor){
-        std::cerr << "Out of Range errorL " << oor.what() << '\n';
-        std::cout << "please check"<<std::endl;
-    }
-    return false;
+    return cycle;
 }
 
 bool DagGraph::detectCycle() const
 {
     // iterate each vertex
     // dfs implement
-    std::vector<default_color_type> color(_numVertices, white_color);
-    for(auto it = _dagMap.cbegin();it!=_dagMap.cend();it++){
-        if(color[it->first] == white_color){
-            if (has_cycle_dfs(it->first, &color[0]))
+    if (isCompact())
+        return _base->detectCycle();
+    int n = (int)_numVertices;
+    forEachEdge([&n](int e1, int e2, int) {
+        n = std::max(n, std::max(e1, e2) + 1);
+        return true;
+    });
+    std::vector<default_color_type> color(n, white_color);
+    for(int v = 0; v < n; ++v){
+        if(color[v] == white_color){
+            if (has_cycle_dfs(v, &color[0]))
                return true;
         }
     }
@@ -220,9 +404,108 @@ bool DagGraph::detectCycle() const
 
 DagMap DagGraph::getDagMap()
 {
+    if (_base) {
+        DagMap dagMap;
+        toDagMap(dagMap);
+        return dagMap;
+    }
     return _dagMap;
 }
 
+void DagGraph::toDagMap(DagMap &dagMap) const
+{
+    dagMap.clear();
+    dagMap.max_load_factor(loadFactor);
+    forEachEdge([&dagMap](int e1, int e2, int count) {
+        dagMap[e1][e2] = count;
+        return true;
+    });
+}
+
+
+void DagGraph::setEdges(std::vector<uint64_t> &edges)
+{
+    _ord.clear();
+    _ordVertex.clear();
+    _dagMap.clear();
+    _baseDelta.clear();
+    auto base = std::make_shared<DagCSR>();
+    base->build(_numVertices, edges);
+    _base = base;
+    _edgeSize = base->getEdgeSize();
+}
+
+void DagGraph::clear()
+{
+    _base.reset();
+    _baseDelta.clear();
+    _ord.clear();
+    _ordVertex.clear();
+    _dagMap.clear();
+    _edgeSize = 0;
+    _numVertices = 0;
+}
+
+void DagGraph::swap(DagGraph &dagGraph)
+{
+    _base.swap(dagGraph._base);
+    _baseDelta.swap(dagGraph._baseDelta);
+    _ord.swap(dagGraph._ord);
+    _ordVertex.swap(dagGraph._ordVertex);
+    _dagMap.swap(dagGraph._dagMap);
+    std::swap(_edgeSize, dagGraph._edgeSize);
+    std::swap(_numVertices, dagGraph._numVertices);
+}
+
+void DagGraph::freeze()
+{
+    if (isCompact() || _edgeSize == 0)
+        return;
+    std::vector<std::pair<uint64_t, int>> edges;
+    edges.reserve(_edgeSize);
+    forEachEdge([&edges](int e1, int e2, int count) {
+        edges.push_back(std::make_pair(DagCSR::packEdge(e1, e2), count));
+        return true;
+    });
+    auto base = std::make_shared<DagCSR>();
+    base->build(_numVertices, edges);
+    _base = base;
+    std::unordered_map<uint64_t, int>().swap(_baseDelta);
+    DagMap().swap(_dagMap);
+    _dagMap.max_load_factor(loadFactor);
+}
+
+bool DagGraph::isCompact() const
+{
+    return _base && _dagMap.empty() && _baseDelta.empty();
+}
+
+void DagGraph::setBase(std::shared_ptr<const DagCSR> base)
+{
+    _ord.clear();
+    _ordVertex.clear();
+    DagMap().swap(_dagMap);
+    _dagMap.max_load_factor(loadFactor);
+    std::unordered_map<uint64_t, int>().swap(_baseDelta);
+    _base = base;
+    _edgeSize = base ? base->getEdgeSize() : 0;
+}
+
+std::shared_ptr<const DagCSR> DagGraph::getCSR() const
+{
+    if (isCompact())
+        return _base;
+    std::vector<std::pair<uint64_t, int>> edges;
+    edges.reserve(_edgeSize);
+    forEachEdge([&edges](int e1, int e2, int count) {
+        edges.push_back(std::make_pair(DagCSR::packEdge(e1, e2), count));
+        return true;
+    });
+    auto csr = std::make_shared<DagCSR>();
+    csr->build(_numVertices, edges);
+    return csr;
+}
+
 
 unsigned int DagGraph::getEdgeSize() const
 {
@@ -231,13 +514,18 @@ unsigned int DagGraph::getEdgeSize() const
 
 unsigned int DagGraph::getNodeSize() const
 {
-    std::set<int> vertices;
-    for(auto it = _dagMap.cbegin();it != _dagMap.cend();it++){
-        vertices.insert(it->first);
-        for(auto innerIt = _dagMap.at(it->first).cbegin();innerIt != _dagMap.at(it->first).cend();innerIt++){
-            vertices.insert(innerIt->first);
-        }
+    if (isCompact()) {
+        std::vector<int> vertices;
+        _base->getVertices(vertices);
+        gLogInfo<<"Dag have "<<vertices.size()<<" all vertices";
+        return (unsigned int)vertices.size();
     }
+    std::set<int> vertices;
+    forEachEdge([&vertices](int e1, int e2, int) {
+        vertices.insert(e1);
+        vertices.insert(e2);
+        return true;
+    });
     gLogInfo<<"Dag have "<<vertices.size()<<" all vertices";
    return vertices.size();
 }
@@ -245,12 +533,18 @@ unsigned int DagGraph::getNodeSize() const
 std::unordered_set<int> DagGraph::getVertices() const
 {
     std::unordered_set<int> vertices;
-    for(auto it = _dagMap.cbegin();it != _dagMap.cend();it++){
-        vertices.insert(it->first);
-        for(auto innerIt = _dagMap.at(it->first).cbegin();innerIt != _dagMap.at(it->first).cend();innerIt++){
-            vertices.insert(innerIt->first);
-        }
+    if (isCompact()) {
+        std::vector<int> sorted;
+        _base->getVertices(sorted);
+        vertices.insert(sorted.begin(), sorted.end());
+        gLogDebug<<"Dag have "<<vertices.size()<<" all vertices";
+        return vertices;
     }
+    forEachEdge([&vertices](int e1, int e2, int) {
+        vertices.insert(e1);
+        vertices.insert(e2);
+        return true;
+    });
     gLogDebug<<"Dag have "<< _dagMap.size()<<"out vertices";
     gLogDebug<<"Dag have "<<vertices.size()<<" all vertices";
    return vertices;
@@ -263,7 +557,14 @@ void DagGraph::saveGraph(std::string filename) const
         boost::archive::text_oarchive oa(ofs);
         oa << _numVertices;
         oa << _edgeSize;
-        oa <<_dagMap;
+        if (_base) {
+            // same archive as the map form
+            DagMap dagMap;
+            toDagMap(dagMap);
+            oa << dagMap;
+        }
+        else
+            oa <<_dagMap;
         ofs.close();
     }
     catch(std::exception &ex){
@@ -271,9 +572,17 @@ void DagGraph::saveGraph(std::string filename) const
     }
 }
 
-void DagGraph::loadGraph(std::string filename)
+bool DagGraph::loadGraph(std::string filename)
 {
     std::ifstream ifs(filename);
+    _base.reset();
+    _baseDelta.clear();
+    _ord.clear();
+    _ordVertex.clear();
+    if (!ifs.is_open()) {
+        gLogError << "Failed to open DAG " << filename;
+        return false;
+    }
     try{
         boost::archive::text_iarchive ia(ifs);
         ia >> _numVertices;
@@ -283,5 +592,7 @@ void DagGraph::loadGraph(std::string filename)
     }
     catch(std::exception &ex){
         gLogError << "Failed to load DAG " << filename << " - " << ex.what();
+        return false;
     }
+    return true;
 }
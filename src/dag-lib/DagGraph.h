@@ -6,15 +6,24 @@
 #include <map>
 #include <deque>
 #include <set>
+#include <memory>
 #include "DLL.h"
 #include "SFVector.h"
 #include "GraphCommon.h"
+#include "DagCSR.h"
 
 typedef std::pair<int, int> Edge;
 typedef std::unordered_map<int, std::unordered_map<int,int> > DagMap;
 
 /*
  * Calculate and save DAG for a single view
+ *
+ * notes: edges are a compact DagCSR base plus changes on top of it: count
+ *        changes of base edges in _baseDelta and other edges in _dagMap.
+ *        The base is never modified, so copies share it and a merge only
+ *        allocates what it adds. freeze() folds the changes into a new base.
+ *        tryUpdateGraph keeps a topological order of the graph and checks
+ *        only the inserted edges against it instead of a full DFS.
  */
 
 class TRIDAG_LIB DagGraph
@@ -23,7 +32,28 @@ private:
     enum default_color_type{ white_color, gray_color, black_color };
 
 protected:
+    std::shared_ptr<const DagCSR>       _base; // shared by copies, may be null
+    std::unordered_map<uint64_t, int>   _baseDelta; // packed base edge to count change
+    std::vector<int>                    _ord; // vertex to topological position, empty if unknown
+    std::vector<int>                    _ordVertex; // topological position to vertex
+
     bool has_cycle_dfs(int vId, default_color_type* color) const;
+    void toDagMap(DagMap &dagMap) const;
+    // count of e1->e2 in the base, 0 if absent
+    inline int baseCount(int e1, int e2) const;
+    inline int baseDelta(int e1, int e2) const;
+    // call f(e1, e2, count) on every edge until it returns false
+    template<class F> bool forEachEdge(F f) const;
+    // call f(e2) on every out edge of e1 until it returns false
+    template<class F> bool forEachOut(int e1, F f) const;
+    // add edge without touching the topological order
+    bool insertEdge(int e1, int e2, int count);
+    // topological order of current edges, false if there is a cycle
+    bool buildOrder();
+    // keep the order valid for a new edge e1->e2, false if it closes a cycle.
+    // changed windows of the order are pushed to undo as (start, old vertices)
+    bool orderEdge(int e1, int e2, std::vector<char> &visited,
+                   std::vector<std::pair<int, std::vector<int>>> &undo);
 
 public:
     DagMap                              _dagMap;
@@ -38,16 +68,33 @@ public:
     bool addEdge(int e1, int e2, int count = 1);
     bool rmEdge(int e1, int e2, int count = 1);
     bool updateGraph(const DagGraph& dagGraph);
+    // add all edges of dagGraph unless they close a cycle, nothing changes then.
+    // edges new to this graph are added to added if given
+    bool tryUpdateGraph(const DagGraph& dagGraph, DagGraph *added = 0);
     bool rmUpdateGraph(const DagGraph& dagGraph);
 	void minusInter(const DagGraph& keep, const DagGraph& rm);
     DagMap getDagMap();
+    // replace all edges by packed edges (see DagCSR::packEdge), kept in compact form
+    void setEdges(std::vector<uint64_t> &edges);
+    // fold all edges into a new compact base
+    void freeze();
+    // remove all edges and vertices, as a new graph
+    void clear();
+    // exchange all edges, vertices and the order with dagGraph
+    void swap(DagGraph &dagGraph);
+    // only base edges, without changes on top
+    bool isCompact() const;
+    // replace all edges by a compact base, may be a view of a mapped file
+    void setBase(std::shared_ptr<const DagCSR> base);
+    // compact form of all edges, the base itself if compact
+    std::shared_ptr<const DagCSR> getCSR() const;
 
     //attr
      bool detectCycle() const;
 
      //io
      void saveGraph(std::string filename) const;
-     void loadGraph(std::string filename);
+     bool loadGraph(std::string filename); // false if the file is missing or broken
 
      unsigned int getEdgeSize() const;
      unsigned int getNodeSize() const;
@@ -55,4 +102,54 @@ public:
      std::unordered_set<int> getVertices() const;
 };
 
+inline int DagGraph::baseCount(int e1, int e2) const
+{
+    return _base ? _base->find(e1, e2) : 0;
+}
+
+inline int DagGraph::baseDelta(int e1, int e2) const
+{
+    if (_baseDelta.empty())
+        return 0;
+    auto it = _baseDelta.find(DagCSR::packEdge(e1, e2));
+    return it == _baseDelta.end() ? 0 : it->second;
+}
+
+template<class F>
+bool DagGraph::forEachEdge(F f) const
+{
+    if (_base) {
+        const DagCSR &base = *_base;
+        for (int v = 0; v < base.getNumberOfVertices(); ++v) {
+            for (auto k = base.rowBegin(v); k < base.rowEnd(v); ++k) {
+                int count = base.count(k) + baseDelta(v, base.target(k));
+                if (count > 0 && !f(v, base.target(k), count))
+                    return false;
+            }
+        }
+    }
+    for (auto it = _dagMap.cbegin(); it != _dagMap.cend(); it++)
+        for (auto innerIt = it->second.cbegin(); innerIt != it->second.cend(); innerIt++)
+            if (!f(it->first, innerIt->first, innerIt->second))
+                return false;
+    return true;
+}
+
+template<class F>
+bool DagGraph::forEachOut(int e1, F f) const
+{
+    if (_base && e1 < _base->getNumberOfVertices()) {
+        const DagCSR &base = *_base;
+        for (auto k = base.rowBegin(e1); k < base.rowEnd(e1); ++k)
+            if (base.count(k) + baseDelta(e1, base.target(k)) > 0 && !f(base.target(k)))
+                return false;
+    }
+    auto it = _dagMap.find(e1);
+    if (it != _dagMap.end())
+        for (const auto &nb : it->second)
+            if (!f(nb.first))
+                return false;
+    return true;
+}
+
 #endif // SFGRAPHCOMMON_H
@@ -1,20 +1,40 @@
 #include "DagMerger.h"
 #include "Log.h"
 #include <unordered_set>
+#include <deque>
+#include <algorithm>
+#include "omp.h"
 #include <boost/serialization/serialization.hpp>
 #include<boost/serialization/map.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include<boost/archive/text_oarchive.hpp>
 
-DAGMerger::DAGMerger(int nNodes,DAGCenter* pDagCenter, SFViewBase *pViewMesh, int metricMode)
+// top edges looked at in a parallel merge round, independent of the
+// number of threads so results don't depend on the machine
+static const int MERGE_ROUND_CANDIDATES = 32;
+
+DAGMerger::DAGMerger(int nNodes,DAGCenter* pDagCenter, SFViewBase *pViewMesh, int metricMode, bool initMerge)
     :_metricMode(metricMode)
     ,_pDagCenter(pDagCenter)
 {
+    if(!initMerge){
+        // only what setAssignments and relaxing read
+        for(auto nodeId =0;nodeId<nNodes;nodeId++)
+            _assignments[nodeId] = nodeId;
+        for(auto edge : pViewMesh->getViewEdges()){
+            _edges[edge.first].insert(edge.second);
+            _edges[edge.second].insert(edge.first);
+        }
+        return;
+    }
     gLogInfo<<"init cluster DAG";
     for(auto id=0; id<nNodes; id++){
        auto tempDag = _pDagCenter->getDag(id);
        _clusterDags[id] = new DAG(*tempDag);
     }
+    // the copies share the edges of the dags, so a trimmed dag is only freed
+    // once its cluster is merged away
+    _pDagCenter->trim();
     gLogInfo<<"init assignments, clusterAssign,cluster neighbour";
     init(nNodes,pViewMesh);
 }
@@ -30,7 +50,7 @@ void DAGMerger::init(int nNodes, SFViewBase *pViewMesh)
 {
     for(auto nodeId =0;nodeId<nNodes;nodeId++){
         _assignments[nodeId] = nodeId;
-        _clusterAssigns[nodeId] = vector<int>{nodeId};
+        _clusterAssigns[nodeId] = std::unordered_set<int>{nodeId};
     }
     this->initEdges(pViewMesh->getViewEdges());
 }
@@ -52,7 +72,7 @@ void DAGMerger::initEdges(const set<Edge> &edges)
 
 bool DAGMerger::hasQueue() const
 {
- return 0<_prioritylist.size();
+ return !_prioritylist.empty();
 }
 
 void DAGMerger::mergeTop()
@@ -60,44 +80,13 @@ void DAGMerger::mergeTop()
     gLogDebug << "########Start Merging";
     // Get top edge
     auto edge = getTopEdge();
-    // if have clusterDags
-    // Get 2 dags
-    auto dag1 = getClusterDag( edge.first );
-    auto dag2 = getClusterDag( edge.second );
 
     // Try merge DAGs
-    // if merge successful, push to clusterDag and change its clusterId to this
-    auto dag3 = mergeDAGs( dag1, dag2 );
-
-    if (dag3) {
-        gLogDebug << "Edge:"<< edge.first << " -- " << edge.second;
-
-        // if doing incrementally , collopseEdge first
-        this->collopseEdge(edge);
-
-        // update
-        int clusterId1 = edge.first;
-        int clusterId2 = edge.second;
-        gLogDebug<<"clusterId "<<clusterId1<<" "<<clusterId2;
-        auto tempFind = _clusterDags.find(clusterId2);
-        delete tempFind->second;
-        _clusterDags[clusterId2] = dag3;
-        _clusterAssigns[clusterId2].insert(_clusterAssigns[clusterId2].end(), _clusterAssigns[clusterId1].begin(),_clusterAssigns[clusterId1].end());
-
-        // update assignments
-        const auto& clusterNodes = _clusterAssigns.at(clusterId1);
-        for(auto it = clusterNodes.begin();it!= clusterNodes.end();it++){
-            _assignments[*it] = clusterId2;
-        }
-
-        tempFind = _clusterDags.find(clusterId1);
-        delete tempFind->second;
-        _clusterDags.erase(clusterId1);
-        _clusterAssigns.erase(clusterId1);
-
-        gLogInfo << "Merged edge: " << edge.first << " -- " << edge.second;
-        gLogDebug<<"clusterDag size: "<<_clusterDags.size();
-
+    // if merge successful, cluster edge.second holds the union and keeps its clusterId
+    DagGraph smallKp;
+    DagGraph smallRm;
+    if (tryMerge(edge, smallKp, smallRm)) {
+        this->commitMerge(edge, smallKp, smallRm);
     }
     else {
         // can't merge
@@ -106,23 +95,107 @@ void DAGMerger::mergeTop()
     this->popEdge(edge);
 }
 
-void DAGMerger::updatePriority(const Edge &edge)
+void DAGMerger::mergeRound(int numThreads)
+{
+    // pick top edges whose clusters are not next to each other, so merging
+    // one pair doesn't change dags or priorities the other pairs read
+    vector<Edge> candidates;
+    _prioritylist.getTopEdges(MERGE_ROUND_CANDIDATES, candidates);
+    std::unordered_set<int> blocked;
+    vector<Edge> selected;
+    for (const auto &edge : candidates) {
+        if (blocked.count(edge.first) || blocked.count(edge.second))
+            continue;
+        selected.push_back(edge);
+        for (auto clusterId : {edge.first, edge.second}) {
+            blocked.insert(clusterId);
+            const auto &nbs = _clusterNbs.at(clusterId);
+            blocked.insert(nbs.begin(), nbs.end());
+        }
+    }
+
+    int nSelected = (int)selected.size();
+    vector<DagGraph> smallKps(nSelected);
+    vector<DagGraph> smallRms(nSelected);
+    vector<char> merged(nSelected, 0);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+    for (int k = 0; k < nSelected; ++k)
+        merged[k] = tryMerge(selected[k], smallKps[k], smallRms[k]);
+
+    // same order for any number of threads
+    for (int k = 0; k < nSelected; ++k) {
+        if (merged[k])
+            this->commitMerge(selected[k], smallKps[k], smallRms[k]);
+        else
+            gLogDebug << "Can't merge edge: " << selected[k].first << " -- " << selected[k].second;
+        this->popEdge(selected[k]);
+    }
+    gLogDebug << "merge round " << nSelected << " pairs";
+}
+
+bool DAGMerger::tryMerge(const Edge &edge, DagGraph &smallKp, DagGraph &smallRm)
 {
-    _prioritylist[edge] = this->calculatePriority(edge.first, edge.second);
-    gLogDebug << "Updated Priority: "<< edge.first << " -- " << edge.second << " = " << _prioritylist[edge];
+    auto dag1 = getClusterDag( edge.first );
+    auto dag2 = _clusterDags.at( edge.second );
+    if (dag1->getEdgeSize() > dag2->getEdgeSize()) {
+        // check the edges of the smaller second against the order of first,
+        // first is removed on success so second takes over the union
+        DagGraph merged(dag1->getDagGraph());
+        if (!merged.tryUpdateGraph(dag2->getDagGraph(), &smallKp))
+            return false;
+        smallRm.minusInter(dag1->getDagGraph(), dag2->getDagGraph());
+        dag2->swapGraph(merged);
+    }
+    else {
+        if (!mergeDAGs( dag1, dag2, &smallRm ))
+            return false;
+        // second holds the union, second - first is the same before and after
+        smallKp.minusInter(dag2->getDagGraph(), dag1->getDagGraph());
+    }
+    // both are only read by shareSize
+    smallKp.freeze();
+    smallRm.freeze();
+    return true;
 }
 
-Edge DAGMerger::getTopEdge() const
+void DAGMerger::commitMerge(const Edge &edge, const DagGraph &smallKp, const DagGraph &smallRm)
 {
-    //float priority = -1;
-    float priority = numeric_limits<int>::min();
-    Edge res;
-    for( auto element: _prioritylist) {
-        if (priority < element.second) {
-            priority = element.second;
-            res = element.first;
-        }
+    gLogDebug << "Edge:"<< edge.first << " -- " << edge.second;
+
+    // if doing incrementally , collopseEdge first
+    this->collopseEdge(edge, smallKp, smallRm);
+
+    // update
+    int clusterId1 = edge.first;
+    int clusterId2 = edge.second;
+    gLogDebug<<"clusterId "<<clusterId1<<" "<<clusterId2;
+    _clusterAssigns[clusterId2].insert(_clusterAssigns[clusterId1].begin(),_clusterAssigns[clusterId1].end());
+
+    // update assignments
+    const auto& clusterNodes = _clusterAssigns.at(clusterId1);
+    for(auto it = clusterNodes.begin();it!= clusterNodes.end();it++){
+        _assignments[*it] = clusterId2;
     }
+
+    auto tempFind = _clusterDags.find(clusterId1);
+    delete tempFind->second;
+    _clusterDags.erase(clusterId1);
+    _clusterAssigns.erase(clusterId1);
+
+    gLogInfo << "Merged edge: " << edge.first << " -- " << edge.second;
+    gLogDebug<<"clusterDag size: "<<_clusterDags.size();
+}
+
+void DAGMerger::updatePriority(const Edge &edge)
+{
+    _prioritylist.set(edge, this->calculatePriority(edge.first, edge.second));
+    gLogDebug << "Updated Priority: "<< edge.first << " -- " << edge.second << " = " << _prioritylist.get(edge);
+}
+
+Edge DAGMerger::getTopEdge()
+{
+    float priority;
+    Edge res = _prioritylist.top(&priority);
     gLogDebug << "Find edge: " << res.first << " -- " << res.second << " with priority: " << priority;
     return res;
 }
@@ -143,19 +216,16 @@ const DAG* DAGMerger::getClusterDag(int id) const
     return _clusterDags.at(id);
 }
 
-DAG* DAGMerger::mergeDAGs(const DAG *dag1, const DAG *dag2) const
+bool DAGMerger::mergeDAGs(const DAG *dag1, DAG *dag2, DagGraph *added) const
 {
-    // if merge fail, return 0
-    // if merge good, return DAG with same id as dag2
-    DAG *dag3 = new DAG(*dag2);
-    if ( dag3->updateDAG(*dag1) ){
+    // only the edges of dag1 are checked against the order of dag2, dag1 is
+    // the smaller one (tryMerge swaps larger clusters, ships add a single dag).
+    // A failed merge stops at the first cycle and is rolled back
+    if ( dag2->tryUpdateDAG(*dag1, added) ){
         gLogDebug << "Find dag candidates for merge " << dag1->getId() << " - " << dag2->getId();
-        return dag3;
-    }
-    else {
-        delete dag3;
-        return 0;
+        return true;
     }
+    return false;
 }
 
 void DAGMerger::_addClusterNb(const int& id1, const int& id2)
@@ -168,7 +238,7 @@ void DAGMerger::_addClusterNb(const int& id1, const int& id2)
 
 // merge two cluster
 // update proritylist and cluster neighbor relation
-void DAGMerger::collopseEdge(const Edge &edge)
+void DAGMerger::collopseEdge(const Edge &edge, const DagGraph &smallKp, const DagGraph &smallRm)
 {
     //1. remove all edges related to edge.first
     //2. update all edges related to edge.second
@@ -181,22 +251,15 @@ void DAGMerger::collopseEdge(const Edge &edge)
     _prioritylist.erase(edge);
 
     //doing incrementally
-    //update priority before update cluster c2 into cluster c1c2
-    const auto& rmDagMap = this->getClusterDag(remove)->getDagGraph();
-    const auto& kpDagMap = this->getClusterDag(keep)->getDagGraph();
-    DagGraph smallKp;
-	smallKp.minusInter(kpDagMap,rmDagMap);
-    DagGraph smallRm;
-    smallRm.minusInter(rmDagMap,kpDagMap);
 
     // sharesize(C,  A ∪ B ) = sharesize(C, A) + sharesize(C, B -A)
     for(auto it = _clusterNbs.at(remove).begin();it!= _clusterNbs.at(remove).end();++it){
         Edge old = remove < *it? Edge(remove,*it):Edge(*it, remove);
-        float oldPrio = _prioritylist[old];
+        float oldPrio = _prioritylist.get(old);
         _prioritylist.erase(old);
         Edge newE = keep < *it? Edge(keep, *it):Edge(*it, keep);
         if(_metricMode == 1)
-            _prioritylist[newE] = oldPrio + this->getClusterDag(*it)->shareSize(smallKp);
+            _prioritylist.set(newE, oldPrio + this->getClusterDag(*it)->shareSize(smallKp));
         else {
             gLogInfo<<"shouldn't update priority incrementally";
         }
@@ -207,7 +270,7 @@ void DAGMerger::collopseEdge(const Edge &edge)
         if (_clusterNbs.at(remove).find(*it) != _clusterNbs.at(remove).end())
             continue;
         Edge old = keep < *it? Edge(keep, *it):Edge(*it, keep);
-        _prioritylist[old] += this->getClusterDag(*it)->shareSize(smallRm);
+        _prioritylist.set(old, _prioritylist.get(old) + this->getClusterDag(*it)->shareSize(smallRm));
     }
 	//_clusterNbs don't have keep
     for(auto it = _clusterNbs.at(remove).begin();it !=_clusterNbs.at(remove).end() ; it++){
@@ -267,6 +330,41 @@ vector<int> DAGMerger::getAssignments()
     return assigns;
 }
 
+bool DAGMerger::setAssignments(const vector<int> &assignments)
+{
+    int numNodes = (int)_assignments.size();
+    if((int)assignments.size() != numNodes){
+        gLogError<<"assignments of "<<assignments.size()<<" dags, expect "<<numNodes;
+        return false;
+    }
+    for(auto clusterId : assignments)
+        if(clusterId < 0 || clusterId >= numNodes){
+            gLogError<<"invalid cluster "<<clusterId<<" in assignments";
+            return false;
+        }
+
+    for(auto it = _clusterDags.begin();it != _clusterDags.end();it++)
+        delete it->second;
+    _clusterDags.clear();
+    _clusterAssigns.clear();
+    _clusterBounds.clear();
+    _clusterNbs.clear();
+    _prioritylist.clear();
+    for(int dagId=0;dagId<numNodes;dagId++){
+        int clusterId = assignments[dagId];
+        _assignments[dagId] = clusterId;
+        _clusterAssigns[clusterId].insert(dagId);
+        auto dag = getDag(dagId);
+        if(_clusterDags.find(clusterId) == _clusterDags.end())
+            _clusterDags[clusterId] = new DAG(clusterId, dag->getDagGraph()._numVertices);
+        _clusterDags.at(clusterId)->updateDAG(*dag);
+    }
+    for(auto it = _clusterDags.begin();it != _clusterDags.end();it++)
+        it->second->freeze();
+    _pDagCenter->trim();
+    return true;
+}
+
 void DAGMerger::showResult()
 {
     gLogInfo << "Final #set = " << _clusterDags.size();
@@ -293,12 +391,18 @@ int DAGMerger::getClusterId(int dagId) const
     return _assignments.at(dagId);
 }
 
+int DAGMerger::getClusterSize(int clusterId) const
+{
+    auto it = _clusterAssigns.find(clusterId);
+    return it == _clusterAssigns.end() ? 0 : (int)it->second.size();
+}
+
 std::set<int> DAGMerger::getClusterNb(int clusterId) const
 {
-    if(_clusterNbs.find(clusterId) == _clusterNbs.end()){
-        gLogError<<"cluster "<<clusterId<<" is not find, please check";
-    }
     std::set<int> clusterNbs;
+    // clusters without neighbor are not kept
+    if(_clusterNbs.find(clusterId) == _clusterNbs.end())
+        return clusterNbs;
     for(auto cluster :_clusterNbs.at(clusterId) )
         clusterNbs.insert(cluster);
     return clusterNbs;
@@ -318,74 +422,69 @@ bool DAGMerger::cleanEmpty(set<int> &clusterIds) const
     return empty;
 }
 
-bool DAGMerger::shipBoundDag(int clusterId,const set<int>& clusterIds, std::unordered_map<int, std::set<int>>& ignoreClusters )
+int DAGMerger::shipBoundDags(int clusterId,const set<int>& clusterIds)
 {
-    if(_clusterAssigns.find(clusterId) == _clusterAssigns.end()){
-        gLogError<<"cluster "<<clusterId<<" is not find in assign, please check";
-    }
-    const auto& dagIds = _clusterAssigns.at(clusterId);
-    if(dagIds.size() == 0){
-        gLogInfo<<"clean cluster "<<clusterId;
-        delete _clusterDags.at(clusterId);
-        _clusterDags.erase(clusterId);
-        _clusterAssigns.erase(clusterId);
-        for(auto it = _clusterNbs.at(clusterId).begin();it !=_clusterNbs.at(clusterId).end() ; it++){
-           _clusterNbs.at(*it).erase(clusterId);
-        }
-        _clusterNbs.erase(clusterId);
-        return false;
+    if(_clusterBounds.find(clusterId) == _clusterBounds.end()){
+        gLogError<<"cluster "<<clusterId<<" is not find in bounds, please check";
+        return 0;
     }
-
-    for(auto dagId:dagIds){
-        const auto& nbDags = _edges.at(dagId);
-        for(auto nbDag : nbDags){
-            if(_assignments[nbDag] != _assignments[dagId]){
-                int newClusterId = _assignments[nbDag];
-                gLogDebug<<" find neighbour dag "<<dagId <<" "<<clusterId<<" "<<nbDag<<" "<<newClusterId;
-                if(clusterIds.find(newClusterId) != clusterIds.end()){
-                    gLogDebug<<"new cluster is among inside clusters";
-                    continue;
-                }
-                if(ignoreClusters.find(dagId) != ignoreClusters.end())
-                    if(ignoreClusters.at(dagId).find(newClusterId) != ignoreClusters.at(dagId).end()){
-                        gLogDebug<<"ignore ship "<<dagId<<" to cluster "<<newClusterId;
-                        continue;
-                    }
-                if(shipDag(dagId,clusterId,newClusterId)){
-                    gLogDebug<<"ship dag "<<dagId <<" from "<<clusterId<<" to "<<newClusterId;
-                    return true;
-                }
-
-                if(ignoreClusters.find(dagId) == ignoreClusters.end())
-                    ignoreClusters[dagId] = std::set<int> {newClusterId};
-                else
-                    ignoreClusters.at(dagId).insert(newClusterId);
+    // empty clusters are removed later by removeEmptyClusters.
+    // A failed ship is not retried, a dag is visited again only when one of its
+    // neighbors left the cluster and it may have a new neighbor cluster
+    const auto& bound = _clusterBounds.at(clusterId);
+    std::deque<int> queue(bound.begin(), bound.end());
+    std::sort(queue.begin(), queue.end());
+    std::unordered_set<int> queued(queue.begin(), queue.end());
+    std::unordered_map<int, std::set<int>> ignoreClusters;
+    int nShipped = 0;
+    while(!queue.empty()){
+        int dagId = queue.front();
+        queue.pop_front();
+        queued.erase(dagId);
+        if(_assignments.at(dagId) != clusterId)
+            continue;
+        for(auto nbDag : _edges.at(dagId)){
+            int newClusterId = _assignments.at(nbDag);
+            if(newClusterId == clusterId)
+                continue;
+            gLogDebug<<" find neighbour dag "<<dagId <<" "<<clusterId<<" "<<nbDag<<" "<<newClusterId;
+            if(clusterIds.find(newClusterId) != clusterIds.end()){
+                gLogDebug<<"new cluster is among inside clusters";
+                continue;
             }
+            auto& ignore = ignoreClusters[dagId];
+            if(ignore.find(newClusterId) != ignore.end()){
+                gLogDebug<<"ignore ship "<<dagId<<" to cluster "<<newClusterId;
+                continue;
+            }
+            if(shipDag(dagId,clusterId,newClusterId)){
+                gLogDebug<<"ship dag "<<dagId <<" from "<<clusterId<<" to "<<newClusterId;
+                nShipped++;
+                for(auto nb : _edges.at(dagId))
+                    if(_assignments.at(nb) == clusterId && queued.insert(nb).second)
+                        queue.push_back(nb);
+                break;
+            }
+            ignore.insert(newClusterId);
         }
     }
-    return false;
+    return nShipped;
 }
 
 bool DAGMerger::shipDag(int dagId, int oldClusterId, int newClusterId)
 {
     auto dag1 = getDag(dagId);
-    auto dag3 = mergeDAGs(dag1,_clusterDags.at(newClusterId));
-    if(dag3){
-        delete _clusterDags.at(newClusterId);
-        if(dag3->detectCycle()){
-            gLogInfo<<"Please check there is cycle!";
-        }
-        _clusterDags.at(newClusterId) = dag3;
+    if(mergeDAGs(dag1,_clusterDags.at(newClusterId))){
         _clusterDags.at(oldClusterId)->rmUpdateDag(*dag1);
-        _assignments[dagId] = newClusterId;
-        _clusterAssigns.at(newClusterId).push_back(dagId);
-         auto it =std::find(_clusterAssigns.at(oldClusterId).begin(),_clusterAssigns.at(oldClusterId).end(),dagId);
-         if(it == _clusterAssigns.at(oldClusterId).end()){
-             gLogError<<"couldn't find dag in oldClusterId";
-         }else{
-             _clusterAssigns.at(oldClusterId).erase(it,it+1);
-         }
-         return true;
+        _assignments.at(dagId) = newClusterId;
+        _clusterAssigns.at(newClusterId).insert(dagId);
+        if(_clusterAssigns.at(oldClusterId).erase(dagId) == 0)
+            gLogError<<"couldn't find dag in oldClusterId";
+        _clusterBounds.at(oldClusterId).erase(dagId);
+        _updateBound(dagId);
+        for(auto nbDag : _edges.at(dagId))
+            _updateBound(nbDag);
+        return true;
     }
     else{
         return false;
@@ -396,12 +495,91 @@ bool DAGMerger::shipDag(int dagId, int oldClusterId, int newClusterId)
 void DAGMerger::updateClusterNbs(const set<Edge> &edges)
 {
     _clusterNbs.clear();
+    _clusterBounds.clear();
+    // every cluster has a boundary entry so ships never add one
+    for(const auto &assign : _clusterAssigns)
+        _clusterBounds[assign.first];
     for (Edge edge: edges) {
         auto clusterId1 = _assignments[edge.first];
         auto clusterId2 = _assignments[edge.second];
         if(clusterId1 != clusterId2){
             _addClusterNb(clusterId1,clusterId2);
             _addClusterNb(clusterId2,clusterId1);
+            _clusterBounds.at(clusterId1).insert(edge.first);
+            _clusterBounds.at(clusterId2).insert(edge.second);
         }
     }
 }
+
+void DAGMerger::_updateBound(int dagId)
+{
+    int clusterId = _assignments.at(dagId);
+    bool isBound = false;
+    for(auto nbDag : _edges.at(dagId))
+        if(_assignments.at(nbDag) != clusterId){
+            isBound = true;
+            break;
+        }
+    auto& bound = _clusterBounds.at(clusterId);
+    if(isBound)
+        bound.insert(dagId);
+    else
+        bound.erase(dagId);
+}
+
+void DAGMerger::relaxCluster(int clusterId)
+{
+    auto clusterNbs = getClusterNb(clusterId);
+    clusterNbs.insert(clusterId);
+
+    gLogDebug<<"relax cluster "<<clusterId;
+    // ship from 1-ring to 2-ring
+    for(auto cluster :clusterNbs){
+        if(cluster == clusterId)
+            continue;
+        shipBoundDags(cluster,clusterNbs);
+    }
+    // ship from center to 1-ring neighbor
+    std::set<int> temp{clusterId};
+    shipBoundDags(clusterId,temp);
+}
+
+void DAGMerger::prefetchRelax(const vector<int> &clusterIds) const
+{
+    if(!_pDagCenter->isPaged())
+        return;
+    vector<int> dagIds;
+    for(auto clusterId : clusterIds){
+        auto clusters = getClusterNb(clusterId);
+        clusters.insert(clusterId);
+        for(auto cluster : clusters){
+            auto it = _clusterBounds.find(cluster);
+            if(it != _clusterBounds.end())
+                dagIds.insert(dagIds.end(), it->second.begin(), it->second.end());
+        }
+    }
+    _pDagCenter->prefetch(dagIds);
+}
+
+int DAGMerger::removeEmptyClusters()
+{
+    vector<int> empty;
+    for(const auto &assign : _clusterAssigns)
+        if(assign.second.empty())
+            empty.push_back(assign.first);
+    for(auto clusterId : empty){
+        gLogInfo<<"clean cluster "<<clusterId;
+        delete _clusterDags.at(clusterId);
+        _clusterDags.erase(clusterId);
+        _clusterAssigns.erase(clusterId);
+        _clusterBounds.erase(clusterId);
+        if(_clusterNbs.find(clusterId) == _clusterNbs.end())
+            continue;
+        for(auto nb : _clusterNbs.at(clusterId)){
+            if(_clusterNbs.find(nb) != _clusterNbs.end())
+                _clusterNbs.at(nb).erase(clusterId);
+        }
+        _clusterNbs.erase(clusterId);
+    }
+    return (int)empty.size();
+}
@@ -4,6 +4,7 @@
 #include "DAG.h"
 #include "DAGCenter.h"
 #include "ViewBase.h"
+#include "EdgeQueue.h"
 #include <unordered_map>
 
 /*
@@ -18,15 +19,18 @@ class TRIDAG_LIB DAGMerger
     int                                                _metricMode;
     DAGCenter*                                         _pDagCenter;
 
-    std::map<Edge,float>                               _prioritylist;
+    EdgeQueue                                          _prioritylist;
     std::unordered_map<int, DAG*>                      _clusterDags; //map clusterId to clusterDAG
-    std::unordered_map<int, vector<int>>               _clusterAssigns; //map clusterId to dagIds within this cluster
+    std::unordered_map<int, std::unordered_set<int>>   _clusterAssigns; //map clusterId to dagIds within this cluster
+    std::unordered_map<int, std::unordered_set<int>>   _clusterBounds; //map clusterId to its dagIds with a neighbor outside, built by updateClusterNbs
     std::map<int,int>                                  _assignments;//map dagId to clusterId
     std::unordered_map<int, std::unordered_set<int>>   _clusterNbs;//map clusterId to its neighbor clusterIds
     std::unordered_map<int, std::unordered_set<int>>   _edges;//map dagId to its neighbor dagIds
 
 public:
-    DAGMerger(int nNodes,DAGCenter* pDagCenter, SFViewBase *pViewMesh, int metricMode);
+    // initMerge false copies no dag and builds no merge queue, the clusters
+    // come from setAssignments
+    DAGMerger(int nNodes,DAGCenter* pDagCenter, SFViewBase *pViewMesh, int metricMode, bool initMerge = true);
     ~DAGMerger();
 
     void init(int nNodes, SFViewBase *pViewMesh);
@@ -34,17 +38,32 @@ public:
     //merging
     bool hasQueue() const;
     void mergeTop(); // pop two cluster to merge
+    // merge independent top edges on numThreads threads, commit in priority order.
+    // The result doesn't depend on numThreads
+    void mergeRound(int numThreads);
 
     //relaxing clusters
-    bool shipBoundDag(int clusterId,const set<int>& clusterIds,std::unordered_map<int, std::set<int>>& ignoreClusters);
+    // ship boundary dags of clusterId to neighbor clusters not in clusterIds until none
+    // can be shipped, return the number of shipped dags
+    int shipBoundDags(int clusterId,const set<int>& clusterIds);
     void updateClusterNbs(const set<Edge> &edges);
     bool cleanEmpty(set<int>& clusterIds) const;
+    // ship dags of the 1-ring of clusterId to the 2-ring, then dags of clusterId to the 1-ring.
+    // Only clusters of the 2-ring are changed and assignments of the 3-ring are read,
+    // emptied clusters stay until removeEmptyClusters
+    void relaxCluster(int clusterId);
+    int removeEmptyClusters(); // return number of removed clusters
+    // page in the boundary dags relaxCluster of these centers will ship
+    void prefetchRelax(const vector<int> &clusterIds) const;
 
     //io
     void showResult();
     int getNumberOfClusters( ) const;
     vector<int> getAssignments();
+    // clusters of saved assignments, each cluster dag is the sum of its dags
+    bool setAssignments(const vector<int> &assignments);
     int getClusterId(int dagId) const;
+    int getClusterSize(int clusterId) const; // number of dags, 0 if removed
     vector<int> getClusterIds() const;
     std::set<int> getClusterNb( int clusterId) const;
     const DAG* getDag(int id) const;
@@ -53,11 +72,20 @@ public:
 protected:
     void initEdges( const set<Edge> &edges ); //init priority queue for neighbor clusters
     void _addClusterNb(const int& id1, const int& id2);//init cluster neighbor
+    void _updateBound(int dagId); // keep dagId in the boundary of its cluster or not
 
-    Edge getTopEdge() const;
+    Edge getTopEdge();
     void popEdge(Edge edge);
-    DAG *mergeDAGs(const DAG* dag1, const DAG* dag2) const;
-    void collopseEdge( const Edge &edge );//incrementally collapse Edge<first, second>, remove first, keep second
+    // merge dag1 into dag2 in place, dag2 is unchanged if that closes a cycle
+    bool mergeDAGs(const DAG* dag1, DAG* dag2, DagGraph *added = 0) const;
+    // merge first into second, on success smallKp is second - first and smallRm
+    // holds the edges first added to second. Only the edges of the smaller cluster
+    // are checked for cycles. Pairs of distinct clusters can run in parallel
+    bool tryMerge(const Edge &edge, DagGraph &smallKp, DagGraph &smallRm);
+    // bookkeeping of a successful tryMerge
+    void commitMerge(const Edge &edge, const DagGraph &smallKp, const DagGraph &smallRm);
+    //incrementally collapse Edge<first, second>, remove first, keep second
+    void collopseEdge( const Edge &edge, const DagGraph &smallKp, const DagGraph &smallRm );
     void updatePriority(const Edge &edge );// update priority
     float calculatePriority(int id1, int id2 ) const;//calculate priority
 
@@ -0,0 +1,110 @@
+#include "EdgeQueue.h"
+#include <algorithm>
+
+// outdated entries allowed per live edge before the heap is rebuilt
+static const size_t MAX_STALE_RATIO = 2;
+
+EdgeQueue::EdgeQueue()
+    :_nextVersion(0)
+{
+}
+
+bool EdgeQueue::lower(const Entry &a, const Entry &b)
+{
+    if (a.priority != b.priority)
+        return a.priority < b.priority;
+    return b.edge < a.edge;
+}
+
+void EdgeQueue::clear()
+{
+    _heap.clear();
+    _current.clear();
+}
+
+bool EdgeQueue::empty() const
+{
+    return _current.empty();
+}
+
+size_t EdgeQueue::size() const
+{
+    return _current.size();
+}
+
+void EdgeQueue::set(const Edge &edge, float priority)
+{
+    Current &cur = _current[edge];
+    cur.priority = priority;
+    cur.version = ++_nextVersion;
+    _heap.push_back(Entry{priority, edge, cur.version});
+    std::push_heap(_heap.begin(), _heap.end(), lower);
+    if (_heap.size() > MAX_STALE_RATIO * _current.size() + 64)
+        rebuild();
+}
+
+float EdgeQueue::get(const Edge &edge) const
+{
+    auto it = _current.find(edge);
+    return it == _current.end() ? 0.0f : it->second.priority;
+}
+
+bool EdgeQueue::find(const Edge &edge) const
+{
+    return _current.find(edge) != _current.end();
+}
+
+void EdgeQueue::erase(const Edge &edge)
+{
+    _current.erase(edge);
+}
+
+bool EdgeQueue::isStale(const Entry &entry) const
+{
+    auto it = _current.find(entry.edge);
+    return it == _current.end() || it->second.version != entry.version;
+}
+
+void EdgeQueue::dropStale()
+{
+    while (!_heap.empty() && isStale(_heap.front())) {
+        std::pop_heap(_heap.begin(), _heap.end(), lower);
+        _heap.pop_back();
+    }
+}
+
+void EdgeQueue::rebuild()
+{
+    _heap.clear();
+    _heap.reserve(_current.size());
+    for (const auto &cur : _current)
+        _heap.push_back(Entry{cur.second.priority, cur.first, cur.second.version});
+    std::make_heap(_heap.begin(), _heap.end(), lower);
+}
+
+Edge EdgeQueue::top(float *priority)
+{
+    dropStale();
+    if (priority)
+        *priority = _heap.front().priority;
+    return _heap.front().edge;
+}
+
+void EdgeQueue::getTopEdges(size_t n, std::vector<Edge> &edges)
+{
+    edges.clear();
+    std::vector<Entry> popped;
+    while (!_heap.empty() && edges.size() < n) {
+        std::pop_heap(_heap.begin(), _heap.end(), lower);
+        Entry entry = _heap.back();
+        _heap.pop_back();
+        if (isStale(entry))
+            continue;
+        edges.push_back(entry.edge);
+        popped.push_back(entry);
+    }
+    for (const auto &entry : popped) {
+        _heap.push_back(entry);
+        std::push_heap(_heap.begin(), _heap.end(), lower);
+    }
+}
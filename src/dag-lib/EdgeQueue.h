@@ -0,0 +1,58 @@
+#ifndef EDGEQUEUE_H
+#define EDGEQUEUE_H
+
+#include <vector>
+#include <map>
+#include "GraphCommon.h"
+#include "DLL.h"
+
+/*
+ * Priority queue of cluster edges for greedy merging
+ *
+ * notes: a binary max heap with lazy invalidation. Changing or removing a
+ *        priority only bumps the version of the edge, outdated heap entries
+ *        are dropped when they reach the top. Ties go to the smallest edge,
+ *        same as the scan over std::map it replaces.
+ */
+class TRIDAG_LIB EdgeQueue
+{
+    struct Entry{
+        float           priority;
+        Edge            edge;
+        unsigned int    version;
+    };
+    struct Current{
+        float           priority;
+        unsigned int    version;
+    };
+
+    std::vector<Entry>              _heap;
+    std::map<Edge, Current>         _current; // live edges
+    unsigned int                    _nextVersion;
+
+    static bool lower(const Entry &a, const Entry &b);
+
+protected:
+    bool isStale(const Entry &entry) const;
+    void dropStale();
+    void rebuild();
+
+public:
+    EdgeQueue();
+
+    void clear();
+    bool empty() const;
+    size_t size() const;
+
+    void set(const Edge &edge, float priority);
+    // 0 if edge is not in the queue
+    float get(const Edge &edge) const;
+    bool find(const Edge &edge) const;
+    void erase(const Edge &edge);
+    // edge with the highest priority, queue must not be empty
+    Edge top(float *priority = 0);
+    // up to n live edges by decreasing priority, the queue is unchanged
+    void getTopEdges(size_t n, std::vector<Edge> &edges);
+};
+
+#endif // EDGEQUEUE_H
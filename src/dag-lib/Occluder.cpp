@@ -4,6 +4,8 @@
 #include <boost/format.hpp>
 #include <omp.h>
 #include <stdexcept>
+#include <thread>
+#include <algorithm>
 
 namespace fs = boost::filesystem;
 
@@ -12,17 +14,21 @@ DagOccluder::DagOccluder(
         double distance, double Parameter1)
     :_viewNodes(viewNodes)
     ,_triangles(triangles)
+    ,_faceWords(0)
+    ,_lazyRelation(false)
     ,_countSum(0)
+    ,_countRel(0)
     ,_countVE(0)
     ,_countDir(0)
-    ,_countRel(0)
 {
     init(distance, Parameter1);
     _nTris = (int)_triangles.size();
-    auto nViewNodes = _viewNodes.size();
-    _cacheVENormMap.clear();
-    for(auto vId=0;vId<nViewNodes;vId++){
-        _cacheVENormMap[vId] = vector<Vector3d>{};
+    for(auto k=0;k<9;k++)
+        _soaVerts[k].resize(_nTris);
+    for(auto j=0;j<_nTris;j++){
+        const auto &tri = _triangles[j];
+        for(auto k=0;k<9;k++)
+            _soaVerts[k][j] = tri._vertices[k/3][k%3];
     }
 }
 
@@ -54,94 +60,143 @@ void DagOccluder::preprocess(int numthreads)
     auto nViewNodes = _viewNodes.size();
     auto nTriangles = _triangles.size();
 
-    //TODO: allocated size may have limit here
+    _faceWords = (nTriangles + 63) / 64;
     _cacheFacesAway.clear();
-    _cacheFacesAway.resize( nTriangles*nViewNodes, false );
-    gLogInfo<<"cacheFaceAway Size "<<_cacheFacesAway.size()<< nTriangles*nViewNodes;
+    _cacheFacesAway.resize( _faceWords*nViewNodes, 0 );
+    gLogInfo<<"cacheFaceAway Size "<<_cacheFacesAway.size()*sizeof(uint64_t)<<" bytes";
+    vector<size_t> nFront(nViewNodes, 0);
 
     omp_set_dynamic(0);     // Explicitly disable dynamic teams
-    omp_set_num_threads(numthreads-1);
+    omp_set_num_threads(numthreads);
     #pragma omp parallel for
-    for (auto i = 0; i < nViewNodes; ++i) {
+    for (auto i = 0; i < (int)nViewNodes; ++i) {
         const auto &view = _viewNodes[i];
-        for (auto j = 0; j < nTriangles; ++j) {
+        uint64_t *row = &_cacheFacesAway[(size_t)i*_faceWords];
+        for (auto j = 0; j < (int)nTriangles; ++j) {
             const auto &tri = _triangles[j];
-            unsigned id = i*nTriangles+j;
-            _cacheFacesAway[id] = calFaceAway(view, tri);
+            if (calFaceAway(view, tri))
+                row[j >> 6] |= uint64_t(1) << (j & 63);
+            else
+                nFront[i]++;
         }
     }
+
+    // compact front facing triangles of each view
+    _frontStart.assign(nViewNodes + 1, 0);
+    for (size_t i = 0; i < nViewNodes; ++i)
+        _frontStart[i+1] = _frontStart[i] + nFront[i];
+    _frontTris.resize(_frontStart[nViewNodes]);
+    #pragma omp parallel for
+    for (auto i = 0; i < (int)nViewNodes; ++i) {
+        size_t pos = _frontStart[i];
+        for (auto j = 0; j < (int)nTriangles; ++j) {
+            if (!isFaceAway(i, j))
+                _frontTris[pos++] = j;
+        }
+    }
+    gLogInfo << "front facing pairs: " << _frontTris.size() << " of " << nTriangles*nViewNodes;
     gLogInfo << "finish calculating face away stats";
 }
 
 
-void DagOccluder::clearVEMap(int vId)
-{
-    _cacheVENormMap.at(vId).clear();
-    _cacheVENormMap.at(vId) = vector<Vector3d>{};
-}
-
-void DagOccluder::preprocessVEMap(int vId)
+void DagOccluder::preprocessVEMap(int vId, VEPlaneCache &planes) const
 {
     const auto &view = _viewNodes[vId];
     auto& point = static_cast<const ViewNodePoint*>(view)->getPoint();
 
-    unsigned cap = _nTris*3;
-    _cacheVENormMap.at(vId).resize(cap,Vector3d(0,0,0));
-    for (auto j = 0; j < _nTris; ++j) {
-        const auto &A = _triangles[j];
-        for(auto id =0;id<3;++id){
+    planes.resize(_nTris);
+    planes.setViewId(vId);
+    planes.setPoint(point);
+    for(auto id =0;id<3;++id){
+        double *nx = planes.plane(id, VEPlaneCache::PC_NX);
+        double *ny = planes.plane(id, VEPlaneCache::PC_NY);
+        double *nz = planes.plane(id, VEPlaneCache::PC_NZ);
+        for (auto j = 0; j < _nTris; ++j) {
+            const auto &A = _triangles[j];
             Vector3d v1 = A.getVertex(id);
             Vector3d v2 = A.getVertex((id+1)%3);
             Vector3d dir1 = v1 - point;       // direction from view to v1
             Vector3d dir2 = v2 - point;       // direction from view to v2
             // plane norm
             auto norm = (dir1.Cross(dir2)).Normalized();
-            unsigned int uId = j*3+id;
-            _cacheVENormMap.at(vId).at(uId) = norm;
+            nx[j] = norm[0];
+            ny[j] = norm[1];
+            nz[j] = norm[2];
         }
     }
 }
 
 
-void DagOccluder::preprocessRelation(int numthreads)
+bool DagOccluder::preprocessRelation(int numthreads, bool lazy)
 {
     gLogInfo << "Calculating triangle pair relation";
-    auto nTriangles = _triangles.size();
-    _relations.clear();
-    try{
-         _relations.resize(nTriangles*nTriangles+1,'4');
+    int nTriangles = (int)_triangles.size();
+    if(!_relations.resize(nTriangles)) {
+        gLogError << "Failed to allocate the relation table of " << nTriangles << " triangles";
+        return false;
     }
-    catch(std::bad_alloc const&)
-    {
-        gLogError<<"memory allocation failed!";
-        gLogInfo<<"max_size: "<<_relations.max_size();
+
+    int nTiles = (nTriangles + RelationTable::TILE_SIZE - 1) / RelationTable::TILE_SIZE;
+    std::vector<std::atomic<unsigned char>>(_relations.getNumberOfTiles()).swap(_tileState);
+    for (auto &state : _tileState)
+        state.store(lazy ? TILE_EMPTY : TILE_DONE);
+    _lazyRelation = lazy;
+    if (lazy) {
+        gLogInfo << "triangle relation is computed on first use";
+        return true;
     }
 
+    // rows of the upper triangle do nTriangles - t1 pairs, equal sized tiles
+    // balance that and each reads two runs of TILE_SIZE triangles
+    std::vector<std::pair<int,int>> tiles;
+    tiles.reserve(_tileState.size());
+    for (int bi = 0; bi < nTiles; bi++)
+        for (int bj = bi; bj < nTiles; bj++)
+            tiles.push_back(std::make_pair(bi, bj));
+
     omp_set_dynamic(0);     // Explicitly disable dynamic teams
-    omp_set_num_threads(numthreads-1);
-#pragma omp parallel for
-    for(int t1 =0;t1<nTriangles;t1++){
+    omp_set_num_threads(numthreads);
+#pragma omp parallel for schedule(dynamic,1)
+    for (int k = 0; k < (int)tiles.size(); k++)
+        calRelationTile(tiles[k].first, tiles[k].second);
+    gLogInfo<<"finish calculating triangle relaiton";
+    return true;
+}
+
+void DagOccluder::calRelationTile(int bi, int bj) const
+{
+    int nTriangles = (int)_triangles.size();
+    int iEnd = std::min(nTriangles, (bi + 1) * RelationTable::TILE_SIZE);
+    int jEnd = std::min(nTriangles, (bj + 1) * RelationTable::TILE_SIZE);
+    for (int t1 = bi * RelationTable::TILE_SIZE; t1 < iEnd; t1++) {
         const Triangle &A = _triangles[t1];
-        for(int t2 =t1+1;t2<nTriangles;t2++){
+        for (int t2 = std::max(t1 + 1, bj * RelationTable::TILE_SIZE); t2 < jEnd; t2++) {
             const Triangle &B = _triangles[t2];
-            unsigned id = t1*nTriangles + t2;
-            if(isCoplanar(A,B)){
-                _relations[id] = '0';
+            // facing away from each other, never occlude
+            if (isCoplanar(A, B)) {
+                _relations.set(t1, t2, 0);
+                continue;
             }
             TriRelation relAB = calOccludeRelation(A, B);
             TriRelation relBA = calOccludeRelation(B, A);
             auto possibleRel = getPossibleRel(relAB, relBA);
-            if(possibleRel == 0)
-                _relations[id] = '0';
-            else if(possibleRel == 1)
-                _relations[id] = '1';
-            else if(possibleRel == 2)
-                _relations[id] = '2';
-            else if(possibleRel == 3)
-                _relations[id] = '3';
+            // logic fault (4) is kept undecided as well
+            _relations.set(t1, t2, possibleRel < 3 ? possibleRel : 3);
         }
     }
-    gLogInfo<<"finish calculating triangle relaiton";
+}
+
+void DagOccluder::_ensureRelation(int t1, int t2) const
+{
+    auto &state = _tileState[_relations.tileIndex(t1, t2)];
+    unsigned char expected = TILE_EMPTY;
+    if (state.compare_exchange_strong(expected, TILE_BUSY)) {
+        calRelationTile(t1 / RelationTable::TILE_SIZE, t2 / RelationTable::TILE_SIZE);
+        state.store(TILE_DONE, std::memory_order_release);
+        return;
+    }
+    while (state.load(std::memory_order_acquire) != TILE_DONE)
+        std::this_thread::yield();
 }
 
 bool DagOccluder::calFaceAway(const ViewNode *view, const Triangle &tri) const
@@ -167,10 +222,14 @@ bool DagOccluder::_calFaceAway(const Triangle &facet, const Triangle &tri) const
     return true;
 }
 
-bool DagOccluder::isFaceAway(int viewId, int triId) const
+const int* DagOccluder::getFrontTris(int viewId) const
+{
+    return _frontTris.data() + _frontStart[viewId];
+}
+
+int DagOccluder::getNumberOfFrontTris(int viewId) const
 {
-    unsigned int id = viewId*_nTris + triId;
-    return _cacheFacesAway[id];
+    return (int)(_frontStart[viewId+1] - _frontStart[viewId]);
 }
 
 bool DagOccluder::isOccludeSimple(const ViewNode *view, const Triangle &A, const Triangle &B, bool debug) const
@@ -223,19 +282,36 @@ bool DagOccluder::_isOccludeSimple(const Triangle &tri, const Triangle &A, const
     return false;
 }
 
-bool DagOccluder::_isNoOccludeSimpleVE(const Vector3d &point, const Triangle &A, const Triangle &B,const int& vId,const int& triId) const
+bool DagOccluder::_isNoOccludeSimpleVE(const Vector3d &point, const Triangle &A, const Triangle &B) const
 {
     for (auto id = 0; id < 3; ++id) {
-//        Vector3d v1 = A.getVertex(id);
-//        Vector3d v2 = A.getVertex((id+1)%3);
-//        Vector3d dir1 = v1 - point;       // direction from view to v1
-//        Vector3d dir2 = v2 - point;       // direction from view to v2
+        Vector3d v1 = A.getVertex(id);
+        Vector3d v2 = A.getVertex((id+1)%3);
+        Vector3d dir1 = v1 - point;       // direction from view to v1
+        Vector3d dir2 = v2 - point;       // direction from view to v2
 
-//        // plane norm
-//        auto norm = (dir1.Cross(dir2)).Normalized();
+        // plane norm
+        auto norm = (dir1.Cross(dir2)).Normalized();
+        bool test = true;
+        for (const auto &v: B._vertices) {
+            if ( ( v - point ).Dot(norm) < -GE_EPSILON ) {
+                test = false;
+                break;
+            }
+        }
+        if (test)
+            return true;
+    }
+    return false;
+}
 
-        unsigned int uId = triId*3+id;
-        const auto& norm = _cacheVENormMap.at(vId).at(uId);
+bool DagOccluder::_isNoOccludeCachedVE(const VEPlaneCache &planes, int planeTri, const Triangle &B) const
+{
+    const auto &point = planes.getPoint();
+    for (auto id = 0; id < 3; ++id) {
+        Vector3d norm(planes.plane(id, VEPlaneCache::PC_NX)[planeTri],
+                      planes.plane(id, VEPlaneCache::PC_NY)[planeTri],
+                      planes.plane(id, VEPlaneCache::PC_NZ)[planeTri]);
         bool test = true;
         for (const auto &v: B._vertices) {
             if ( ( v - point ).Dot(norm) < -GE_EPSILON ) {
@@ -637,9 +713,9 @@ void DagOccluder::occludeSimple(vector<int> &res,int t1, int t2, bool debug) con
     return ;
 }
 
-int DagOccluder::occludeSimple(int viewId,int t1, int t2, bool testShareEdge) const
+int DagOccluder::occludeSimple(const VEPlaneCache &planes, int t1, int t2) const
 {
-    const auto &view = _viewNodes[viewId];
+    const auto &view = _viewNodes[planes.getViewId()];
 //    if(view->getType() != 0){
 //        gLogError<<"This function only support point only! ";
 //        exit(-1);
@@ -649,24 +725,24 @@ int DagOccluder::occludeSimple(int viewId,int t1, int t2, bool testShareEdge) co
     const Triangle &A = _triangles[t1];
     const Triangle &B = _triangles[t2];
 
-    unsigned int uId = t1*_nTris + t2;
-    auto possibleRel = _relations[uId];
+    ensureRelation(t1, t2);
+    auto possibleRel = _relations.get(t1, t2);
 
-    if(possibleRel == '0')
+    if(possibleRel == 0)
         return 0;
-    bool ab = _isNoOccludeSimpleVE(point, A, B,viewId,t1);
+    bool ab = _isNoOccludeCachedVE(planes, t1, B);
     if(ab)
         return 0;
 
-    bool ba = _isNoOccludeSimpleVE(point, B, A,viewId,t2);
+    bool ba = _isNoOccludeCachedVE(planes, t2, A);
 
     if (ba) {
         return 0;
     }
 
-    if(possibleRel == '1')
+    if(possibleRel == 1)
         return 1;
-    else if(possibleRel == '2')
+    else if(possibleRel == 2)
         return 2;
 
     // has occlusion, A may occlude B or B may occlude A.
@@ -674,6 +750,62 @@ int DagOccluder::occludeSimple(int viewId,int t1, int t2, bool testShareEdge) co
     return dir;
 }
 
+void DagOccluder::occludeSimple(const VEPlaneCache &planes, int t1, const vector<int> &t2s, vector<int> &res,
+                                BatchScratch &scratch) const
+{
+    const auto &view = _viewNodes[planes.getViewId()];
+    auto& point = static_cast<const ViewNodePoint*>(view)->getPoint();
+    const Triangle &A = _triangles[t1];
+
+    res.assign(t2s.size(), 0);
+    auto &active = scratch.active;
+    auto &activeTris = scratch.activeTris;
+    auto &sep = scratch.sep;
+    active.clear();
+    activeTris.clear();
+    // sorted t2s visit the relation tiles of row t1 one after another,
+    // so each tile is only checked on its first pair
+    uint64_t lastTile = ~uint64_t(0);
+    for (size_t k = 0; k < t2s.size(); ++k) {
+        auto tile = _relations.tileIndex(t1, t2s[k]);
+        if (tile != lastTile) {
+            ensureRelation(t1, t2s[k]);
+            lastTile = tile;
+        }
+        if (_relations.get(t1, t2s[k]) != 0) {
+            active.push_back((int)k);
+            activeTris.push_back(t2s[k]);
+        }
+    }
+
+    sep.resize(active.size());
+    _isNoOccludeBatchVE(planes, t1, activeTris.data(), (int)activeTris.size(), sep.data());
+    size_t nKeep = 0;
+    for (size_t k = 0; k < active.size(); ++k) {
+        if (!sep[k]) {
+            active[nKeep] = active[k];
+            activeTris[nKeep] = activeTris[k];
+            nKeep++;
+        }
+    }
+    active.resize(nKeep);
+    activeTris.resize(nKeep);
+
+    _isNoOccludeBatchEV(planes, t1, activeTris.data(), (int)activeTris.size(), sep.data());
+    for (size_t k = 0; k < active.size(); ++k) {
+        if (sep[k])
+            continue;
+        auto t2 = activeTris[k];
+        auto possibleRel = _relations.get(t1, t2);
+        if(possibleRel == 1)
+            res[active[k]] = 1;
+        else if(possibleRel == 2)
+            res[active[k]] = 2;
+        else
+            res[active[k]] = occludeDirection(point, A, _triangles[t2]);
+    }
+}
+
 void DagOccluder::logCountVE()
 {
     gLogInfo<<"count Sum "<<_countSum;
@@ -3,8 +3,11 @@
 
 #include "SFVector.h"
 #include "GraphCommon.h"
+#include "RelationTable.h"
+#include "VEPlaneCache.h"
 #include "DLL.h"
 #include <unordered_map>
+#include <atomic>
 
 /*
  * Function to compute occlusion relation of two triangles for a given view
@@ -40,17 +43,32 @@ protected:
     double   _Parameter1;
     const vector<ViewNode *> &_viewNodes;
     const vector<Triangle> &_triangles;
-    vector<bool> _cacheFacesAway;
-    vector<char> _relations;
+    // face away bits, row of each view starts on a new word so views can be filled in parallel
+    vector<uint64_t> _cacheFacesAway;
+    size_t       _faceWords;    // words per view
+    vector<size_t> _frontStart; // from viewId to its range in _frontTris
+    vector<int>  _frontTris;    // front facing triIds of each view, increasing
+    mutable RelationTable _relations; // filled on first access of a tile if _lazyRelation
+    bool         _lazyRelation;
+    mutable std::vector<std::atomic<unsigned char>> _tileState; // TileState per relation tile
     int          _nTris;
     mutable int  _countSum;
     mutable int  _countRel;
     mutable int  _countVE;
     mutable int  _countDir;
-    std::unordered_map<int,vector<Vector3d>> _cacheVENormMap;
+    // structure of arrays copy of triangle vertices,
+    // component c of vertex v of triangle j is at _soaVerts[v*3+c][j]
+    vector<double> _soaVerts[9];
 
 protected:
+    enum TileState{ TILE_EMPTY = 0, TILE_BUSY, TILE_DONE };
+
     void init(double distance, double Parameter1 = 1000.0f);
+    // relations of the pairs t1 < t2 in relation tile (bi, bj)
+    void calRelationTile(int bi, int bj) const;
+    // compute the tile of t1 < t2 unless done, other threads wait for it
+    inline void ensureRelation(int t1, int t2) const;
+    void _ensureRelation(int t1, int t2) const;
 
     /*
      * utility functions
@@ -68,7 +86,16 @@ protected:
     bool _isOccludeSimple(const Vector3d &point, const Triangle &A, const Triangle &B, bool debug=false) const;
     bool _isOccludeSimple(const Triangle &tri, const Triangle &A, const Triangle &B, bool debug=false) const;
     //Use point and A's 2 vertices to form a cutting plane, if the plane separate B's all vertices, there is no occlude.
-    bool _isNoOccludeSimpleVE(const Vector3d &point, const Triangle &A, const Triangle &B,const int& vId = -1,const int& triId = -1) const;
+    bool _isNoOccludeSimpleVE(const Vector3d &point, const Triangle &A, const Triangle &B) const;
+    // same test with planes of triangle planeTri taken from the view's plane cache
+    bool _isNoOccludeCachedVE(const VEPlaneCache &planes, int planeTri, const Triangle &B) const;
+    // Batch version of _isNoOccludeCachedVE, implemented in OccluderSIMD.cpp
+    // planeTri's planes are tested against each of triIds[0..n), out[k] = 1 if separated
+    void _isNoOccludeBatchVE(const VEPlaneCache &planes, int planeTri,
+                             const int *triIds, int n, unsigned char *out) const;
+    // planes of each of triIds[0..n) are tested against vertTri
+    void _isNoOccludeBatchEV(const VEPlaneCache &planes, int vertTri,
+                             const int *triIds, int n, unsigned char *out) const;
 
     int occludeDirection(const Vector3d &view, const Triangle &A, const Triangle &B) const;
 
@@ -103,20 +130,50 @@ protected:
                           const Vector3d &center) const;
 
 public:
+    // buffers of the batch occludeSimple, owned by one worker thread so
+    // they are allocated once instead of for every front triangle
+    struct BatchScratch{
+        vector<int>             active; // pairs that survive each stage, as index into t2s
+        vector<int>             activeTris;
+        vector<unsigned char>   sep;
+    };
+
     DagOccluder(const vector<ViewNode *> &viewNodes, const vector<Triangle> &triangles, double distance,
                 double Parameter1 = 1000.0f);
 
     ~DagOccluder();
     void preprocess(int numthreads);
-    void preprocessRelation(int numthreads);
-    void preprocessVEMap(int vId);
-    void clearVEMap(int vId);
-
-    bool isFaceAway(int viewId, int triId) const;
+    // lazy only allocates the table, tiles are computed on first access by occludeSimple.
+    // false if the table can't be allocated, the occluder must not be used then
+    bool preprocessRelation(int numthreads, bool lazy = false);
+    // fill planes of point view vId, planes is owned by the calling thread
+    void preprocessVEMap(int vId, VEPlaneCache &planes) const;
+
+    inline bool isFaceAway(int viewId, int triId) const;
+    // front facing triangles of viewId, valid after preprocess
+    const int* getFrontTris(int viewId) const;
+    int getNumberOfFrontTris(int viewId) const;
     void occludeSimple(vector<int>& relations,int t1, int t2, bool debug = false) const;// using only vertices
-    int occludeSimple(int viewId,int t1, int t2,bool testShareEdge) const;// only for point here
+    int occludeSimple(const VEPlaneCache &planes, int t1, int t2) const;// only for point here
+    // same as above for all t2 in t2s (t1 < t2), relations are written to res.
+    // t2s should be sorted so relation lookups stay tile-local
+    void occludeSimple(const VEPlaneCache &planes, int t1, const vector<int>& t2s, vector<int>& res,
+                       BatchScratch &scratch) const;
     bool isOccludeSimple(const ViewNode *view, const Triangle &A, const Triangle &B, bool debug=false) const;
     void logCountVE();// log info for VE
 };
 
+inline bool DagOccluder::isFaceAway(int viewId, int triId) const
+{
+    size_t id = (size_t)viewId*_faceWords + (triId >> 6);
+    return (_cacheFacesAway[id] >> (triId & 63)) & 1;
+}
+
+inline void DagOccluder::ensureRelation(int t1, int t2) const
+{
+    if (_lazyRelation
+            && _tileState[_relations.tileIndex(t1, t2)].load(std::memory_order_acquire) != TILE_DONE)
+        _ensureRelation(t1, t2);
+}
+
 #endif // DAGOCCLUDER_H
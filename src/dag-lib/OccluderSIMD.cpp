@@ -0,0 +1,167 @@
+#include "Occluder.h"
+#include "Log.h"
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/*
+ * SIMD kernels of the vertex-edge plane test
+ *
+ * notes: vertices are taken relative to the view point and the dot products
+ *        are evaluated in the same order as Vector3d::Dot without fused
+ *        multiply add, so results match _isNoOccludeCachedVE.
+ *        Left over pairs of a batch go through the scalar path.
+ */
+
+void DagOccluder::_isNoOccludeBatchVE(const VEPlaneCache &planes, int planeTri,
+                                      const int *triIds, int n, unsigned char *out) const
+{
+    int k = 0;
+
+#if defined(__AVX512F__)
+    const __m512d negEps = _mm512_set1_pd(-GE_EPSILON);
+    const auto &point = planes.getPoint();
+    const __m512d px = _mm512_set1_pd(point[0]);
+    const __m512d py = _mm512_set1_pd(point[1]);
+    const __m512d pz = _mm512_set1_pd(point[2]);
+    __m512d nx[3], ny[3], nz[3];
+    for (int e = 0; e < 3; ++e) {
+        nx[e] = _mm512_set1_pd(planes.plane(e, VEPlaneCache::PC_NX)[planeTri]);
+        ny[e] = _mm512_set1_pd(planes.plane(e, VEPlaneCache::PC_NY)[planeTri]);
+        nz[e] = _mm512_set1_pd(planes.plane(e, VEPlaneCache::PC_NZ)[planeTri]);
+    }
+    for (; k + 8 <= n; k += 8) {
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(triIds + k));
+        __m512d vx[3], vy[3], vz[3];
+        for (int v = 0; v < 3; ++v) {
+            vx[v] = _mm512_sub_pd(_mm512_i32gather_pd(idx, _soaVerts[v*3].data(), 8), px);
+            vy[v] = _mm512_sub_pd(_mm512_i32gather_pd(idx, _soaVerts[v*3+1].data(), 8), py);
+            vz[v] = _mm512_sub_pd(_mm512_i32gather_pd(idx, _soaVerts[v*3+2].data(), 8), pz);
+        }
+        __mmask8 sep = 0;
+        for (int e = 0; e < 3; ++e) {
+            __mmask8 test = 0xFF;
+            for (int v = 0; v < 3; ++v) {
+                __m512d d = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(vx[v], nx[e]),
+                                                        _mm512_mul_pd(vy[v], ny[e])),
+                                          _mm512_mul_pd(vz[v], nz[e]));
+                test &= _mm512_cmp_pd_mask(d, negEps, _CMP_NLT_UQ);
+            }
+            sep |= test;
+        }
+        for (int l = 0; l < 8; ++l)
+            out[k + l] = (sep >> l) & 1;
+    }
+#elif defined(__AVX2__)
+    const __m256d negEps = _mm256_set1_pd(-GE_EPSILON);
+    const auto &point = planes.getPoint();
+    const __m256d px = _mm256_set1_pd(point[0]);
+    const __m256d py = _mm256_set1_pd(point[1]);
+    const __m256d pz = _mm256_set1_pd(point[2]);
+    __m256d nx[3], ny[3], nz[3];
+    for (int e = 0; e < 3; ++e) {
+        nx[e] = _mm256_set1_pd(planes.plane(e, VEPlaneCache::PC_NX)[planeTri]);
+        ny[e] = _mm256_set1_pd(planes.plane(e, VEPlaneCache::PC_NY)[planeTri]);
+        nz[e] = _mm256_set1_pd(planes.plane(e, VEPlaneCache::PC_NZ)[planeTri]);
+    }
+    for (; k + 4 <= n; k += 4) {
+        __m128i idx = _mm_loadu_si128((const __m128i*)(triIds + k));
+        __m256d vx[3], vy[3], vz[3];
+        for (int v = 0; v < 3; ++v) {
+            vx[v] = _mm256_sub_pd(_mm256_i32gather_pd(_soaVerts[v*3].data(), idx, 8), px);
+            vy[v] = _mm256_sub_pd(_mm256_i32gather_pd(_soaVerts[v*3+1].data(), idx, 8), py);
+            vz[v] = _mm256_sub_pd(_mm256_i32gather_pd(_soaVerts[v*3+2].data(), idx, 8), pz);
+        }
+        __m256d sep = _mm256_setzero_pd();
+        for (int e = 0; e < 3; ++e) {
+            __m256d test = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+            for (int v = 0; v < 3; ++v) {
+                __m256d d = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(vx[v], nx[e]),
+                                                        _mm256_mul_pd(vy[v], ny[e])),
+                                          _mm256_mul_pd(vz[v], nz[e]));
+                test = _mm256_and_pd(test, _mm256_cmp_pd(d, negEps, _CMP_NLT_UQ));
+            }
+            sep = _mm256_or_pd(sep, test);
+        }
+        int mask = _mm256_movemask_pd(sep);
+        for (int l = 0; l < 4; ++l)
+            out[k + l] = (mask >> l) & 1;
+    }
+#endif
+
+    for (; k < n; ++k)
+        out[k] = _isNoOccludeCachedVE(planes, planeTri, _triangles[triIds[k]]);
+}
+
+void DagOccluder::_isNoOccludeBatchEV(const VEPlaneCache &planes, int vertTri,
+                                      const int *triIds, int n, unsigned char *out) const
+{
+    const Triangle &A = _triangles[vertTri];
+    int k = 0;
+
+#if defined(__AVX512F__)
+    const __m512d negEps = _mm512_set1_pd(-GE_EPSILON);
+    const auto &point = planes.getPoint();
+    __m512d ax[3], ay[3], az[3];
+    for (int v = 0; v < 3; ++v) {
+        Vector3d rel = A._vertices[v] - point;
+        ax[v] = _mm512_set1_pd(rel[0]);
+        ay[v] = _mm512_set1_pd(rel[1]);
+        az[v] = _mm512_set1_pd(rel[2]);
+    }
+    for (; k + 8 <= n; k += 8) {
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(triIds + k));
+        __mmask8 sep = 0;
+        for (int e = 0; e < 3; ++e) {
+            __m512d nx = _mm512_i32gather_pd(idx, planes.plane(e, VEPlaneCache::PC_NX), 8);
+            __m512d ny = _mm512_i32gather_pd(idx, planes.plane(e, VEPlaneCache::PC_NY), 8);
+            __m512d nz = _mm512_i32gather_pd(idx, planes.plane(e, VEPlaneCache::PC_NZ), 8);
+            __mmask8 test = 0xFF;
+            for (int v = 0; v < 3; ++v) {
+                __m512d d = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(ax[v], nx),
+                                                        _mm512_mul_pd(ay[v], ny)),
+                                          _mm512_mul_pd(az[v], nz));
+                test &= _mm512_cmp_pd_mask(d, negEps, _CMP_NLT_UQ);
+            }
+            sep |= test;
+        }
+        for (int l = 0; l < 8; ++l)
+            out[k + l] = (sep >> l) & 1;
+    }
+#elif defined(__AVX2__)
+    const __m256d negEps = _mm256_set1_pd(-GE_EPSILON);
+    const auto &point = planes.getPoint();
+    __m256d ax[3], ay[3], az[3];
+    for (int v = 0; v < 3; ++v) {
+        Vector3d rel = A._vertices[v] - point;
+        ax[v] = _mm256_set1_pd(rel[0]);
+        ay[v] = _mm256_set1_pd(rel[1]);
+        az[v] = _mm256_set1_pd(rel[2]);
+    }
+    for (; k + 4 <= n; k += 4) {
+        __m128i idx = _mm_loadu_si128((const __m128i*)(triIds + k));
+        __m256d sep = _mm256_setzero_pd();
+        for (int e = 0; e < 3; ++e) {
+            __m256d nx = _mm256_i32gather_pd(planes.plane(e, VEPlaneCache::PC_NX), idx, 8);
+            __m256d ny = _mm256_i32gather_pd(planes.plane(e, VEPlaneCache::PC_NY), idx, 8);
+            __m256d nz = _mm256_i32gather_pd(planes.plane(e, VEPlaneCache::PC_NZ), idx, 8);
+            __m256d test = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+            for (int v = 0; v < 3; ++v) {
+                __m256d d = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ax[v], nx),
+                                                        _mm256_mul_pd(ay[v], ny)),
+                                          _mm256_mul_pd(az[v], nz));
+                test = _mm256_and_pd(test, _mm256_cmp_pd(d, negEps, _CMP_NLT_UQ));
+            }
+            sep = _mm256_or_pd(sep, test);
+        }
+        int mask = _mm256_movemask_pd(sep);
+        for (int l = 0; l < 4; ++l)
+            out[k + l] = (mask >> l) & 1;
+    }
+#endif
+
+    for (; k < n; ++k) {
+        int t2 = triIds[k];
+        out[k] = _isNoOccludeCachedVE(planes, t2, A);
+    }
+}
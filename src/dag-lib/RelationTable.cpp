@@ -0,0 +1,52 @@
+#include "RelationTable.h"
+#include "Log.h"
+#include <new>
+
+RelationTable::RelationTable()
+    :_nTris(0)
+    ,_nTiles(0)
+{
+}
+
+bool RelationTable::resize(int nTris)
+{
+    clear();
+    _nTris = nTris;
+    _nTiles = (nTris + TILE_SIZE - 1) / TILE_SIZE;
+    uint64_t nTileBlocks = (uint64_t)_nTiles * (_nTiles + 1) / 2;
+    try{
+        _words.resize(nTileBlocks * TILE_WORDS, 0);
+    }
+    catch(std::bad_alloc const&)
+    {
+        gLogError<<"memory allocation failed!";
+        gLogInfo<<"max_size: "<<_words.max_size();
+        clear();
+        return false;
+    }
+    gLogInfo<<"relation table size "<<getMemorySize()<<" bytes";
+    return true;
+}
+
+void RelationTable::clear()
+{
+    _words.clear();
+    _words.shrink_to_fit();
+    _nTris = 0;
+    _nTiles = 0;
+}
+
+uint64_t RelationTable::getNumberOfTiles() const
+{
+    return (uint64_t)_nTiles * (_nTiles + 1) / 2;
+}
+
+int RelationTable::getNumberOfTriangles() const
+{
+    return _nTris;
+}
+
+size_t RelationTable::getMemorySize() const
+{
+    return _words.size() * sizeof(uint64_t);
+}
@@ -0,0 +1,83 @@
+#ifndef RELATIONTABLE_H
+#define RELATIONTABLE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "DLL.h"
+
+/*
+ * Compact table of possible occlude relations for triangle pairs
+ *
+ * notes: only the upper triangle (t1 < t2) is stored, 2 bits per pair.
+ *        Pairs are grouped in TILE_SIZE x TILE_SIZE tiles so that a row
+ *        of a tile is word aligned and consecutive t2 stay in one cache line.
+ *        Relation values follow getPossibleRel: 0 no occlude, 1 A->B,
+ *        2 B->A, 3 undecided.
+ */
+class TRIDAG_LIB RelationTable
+{
+public:
+    static const int TILE_SIZE = 64;
+
+private:
+    static const int TILE_WORDS = TILE_SIZE * TILE_SIZE / 32; // 32 pairs per word
+
+    int                         _nTris;
+    int                         _nTiles;   // tiles along one side
+    std::vector<uint64_t>       _words;
+
+protected:
+    // 64 bit index of the pair inside _words, in units of pairs
+    inline uint64_t pairIndex(int t1, int t2) const;
+
+public:
+    RelationTable();
+
+    // allocate for nTris triangles, all relations set to 0
+    // return false if allocation fails
+    bool resize(int nTris);
+    void clear();
+
+    // t1 < t2. Rows of different t1 never share a word, so rows can be filled in parallel
+    inline void set(int t1, int t2, int rel);
+    inline int get(int t1, int t2) const;
+
+    // tile of pair t1 <= t2, tiles don't share words so each can be filled by its own thread
+    inline uint64_t tileIndex(int t1, int t2) const;
+    uint64_t getNumberOfTiles() const;
+
+    int getNumberOfTriangles() const;
+    size_t getMemorySize() const; // in bytes
+};
+
+inline uint64_t RelationTable::tileIndex(int t1, int t2) const
+{
+    uint64_t bi = (uint64_t)(t1 / TILE_SIZE);
+    uint64_t bj = (uint64_t)(t2 / TILE_SIZE);
+    // tiles of the upper triangle are stored row by row
+    return bi * _nTiles - bi * (bi - 1) / 2 + (bj - bi);
+}
+
+inline uint64_t RelationTable::pairIndex(int t1, int t2) const
+{
+    return tileIndex(t1, t2) * TILE_SIZE * TILE_SIZE
+            + (uint64_t)(t1 % TILE_SIZE) * TILE_SIZE + (uint64_t)(t2 % TILE_SIZE);
+}
+
+inline void RelationTable::set(int t1, int t2, int rel)
+{
+    uint64_t id = pairIndex(t1, t2);
+    uint64_t &word = _words[id >> 5];
+    unsigned shift = (unsigned)(id & 31) * 2;
+    word = (word & ~(uint64_t(3) << shift)) | (uint64_t(rel & 3) << shift);
+}
+
+inline int RelationTable::get(int t1, int t2) const
+{
+    uint64_t id = pairIndex(t1, t2);
+    unsigned shift = (unsigned)(id & 31) * 2;
+    return (int)((_words[id >> 5] >> shift) & 3);
+}
+
+#endif // RELATIONTABLE_H
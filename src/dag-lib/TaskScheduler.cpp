@@ -0,0 +1,84 @@
+#include "TaskScheduler.h"
+#include "Log.h"
+#include <thread>
+
+TaskScheduler::TaskScheduler(int nThreads)
+    :_nThreads(nThreads < 1 ? 1 : nThreads)
+    ,_pending(0)
+    ,_nSteals(0)
+{
+    for (int i = 0; i < _nThreads; ++i)
+        _workers.push_back(new Worker);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    for (auto worker : _workers)
+        delete worker;
+}
+
+int TaskScheduler::getNumberOfThreads() const
+{
+    return _nThreads;
+}
+
+void TaskScheduler::push(const Task &task, int workerId)
+{
+    Worker *worker = _workers[workerId % _nThreads];
+    _pending++;
+    std::lock_guard<std::mutex> guard(worker->lock);
+    worker->tasks.push_back(task);
+}
+
+bool TaskScheduler::popLocal(int workerId, Task &task)
+{
+    Worker *worker = _workers[workerId];
+    std::lock_guard<std::mutex> guard(worker->lock);
+    if (worker->tasks.empty())
+        return false;
+    task = std::move(worker->tasks.back());
+    worker->tasks.pop_back();
+    return true;
+}
+
+bool TaskScheduler::steal(int workerId, Task &task)
+{
+    for (int k = 1; k < _nThreads; ++k) {
+        Worker *victim = _workers[(workerId + k) % _nThreads];
+        std::lock_guard<std::mutex> guard(victim->lock);
+        if (victim->tasks.empty())
+            continue;
+        task = std::move(victim->tasks.front());
+        victim->tasks.pop_front();
+        _nSteals++;
+        return true;
+    }
+    return false;
+}
+
+void TaskScheduler::workerLoop(int workerId)
+{
+    Task task;
+    while (_pending > 0) {
+        if (popLocal(workerId, task) || steal(workerId, task)) {
+            task(workerId);
+            // children are pushed before the parent is counted as finished
+            _pending--;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskScheduler::run()
+{
+    _nSteals = 0;
+    std::vector<std::thread> threads;
+    for (int i = 1; i < _nThreads; ++i)
+        threads.push_back(std::thread(&TaskScheduler::workerLoop, this, i));
+    workerLoop(0);
+    for (auto &t : threads)
+        t.join();
+    gLogDebug << "task scheduler: " << _nThreads << " threads, " << _nSteals << " steals";
+}
@@ -0,0 +1,54 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "DLL.h"
+
+/*
+ * Work stealing scheduler for independent tasks
+ *
+ * notes: every worker owns a deque. A worker pops its own newest task first
+ *        and steals the oldest task of another worker when it runs dry.
+ *        Tasks may push more tasks; run() returns once all of them are done.
+ *        (OpenMP tasks are not available with MSVC's OpenMP 2.0.)
+ */
+class TRIDAG_LIB TaskScheduler
+{
+public:
+    typedef std::function<void(int)> Task; // argument is the id of the running worker
+
+private:
+    struct Worker{
+        std::mutex          lock;
+        std::deque<Task>    tasks;
+    };
+
+    int                         _nThreads;
+    std::vector<Worker*>        _workers;
+    std::atomic<long long>      _pending;  // pushed but not finished tasks
+    std::atomic<long long>      _nSteals;
+
+    TaskScheduler(const TaskScheduler&);
+    TaskScheduler& operator=(const TaskScheduler&);
+
+protected:
+    bool popLocal(int workerId, Task &task);
+    bool steal(int workerId, Task &task);
+    void workerLoop(int workerId);
+
+public:
+    TaskScheduler(int nThreads);
+    ~TaskScheduler();
+
+    int getNumberOfThreads() const;
+    // push to the deque of workerId, use the running worker's id from inside a task
+    void push(const Task &task, int workerId = 0);
+    // run until every task is finished, the calling thread is worker 0
+    void run();
+};
+
+#endif // TASKSCHEDULER_H
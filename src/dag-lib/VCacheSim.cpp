@@ -0,0 +1,78 @@
+#include "VCacheSim.h"
+#include <algorithm>
+
+VCacheSim::VCacheSim(Policy policy, int cacheSize)
+    :_policy(policy)
+    ,_cacheSize(std::max(1, cacheSize))
+    ,_misses(0)
+{
+}
+
+void VCacheSim::reset()
+{
+    _misses = 0;
+    _stamps.clear();
+    _entries.clear();
+}
+
+bool VCacheSim::access(int vId)
+{
+    if (_policy == FIFO) {
+        if (vId >= (int)_stamps.size())
+            _stamps.resize(vId + 1, -1);
+        if (_stamps[vId] >= 0 && _misses - _stamps[vId] < _cacheSize)
+            return true;
+        _stamps[vId] = _misses++;
+        return false;
+    }
+
+    auto it = std::find(_entries.begin(), _entries.end(), vId);
+    bool hit = it != _entries.end();
+    if (hit) {
+        _entries.erase(it);
+    }
+    else {
+        _misses++;
+        if ((int)_entries.size() == _cacheSize)
+            _entries.pop_back();
+    }
+    _entries.insert(_entries.begin(), vId);
+    return hit;
+}
+
+VCacheSim::Stats VCacheSim::simulate(const std::vector<int> &indices, Policy policy, int cacheSize)
+{
+    VCacheSim sim(policy, cacheSize);
+    std::vector<char> seen;
+    Stats stats;
+    stats.numTris = (int)indices.size() / 3;
+    stats.numVerts = 0;
+    for (int i = 0; i < stats.numTris * 3; ++i) {
+        int vId = indices[i];
+        if (vId >= (int)seen.size())
+            seen.resize(vId + 1, 0);
+        if (!seen[vId]) {
+            seen[vId] = 1;
+            stats.numVerts++;
+        }
+        sim.access(vId);
+    }
+    stats.misses = sim.getMisses();
+    return stats;
+}
+
+const char* VCacheSim::policyName(Policy policy)
+{
+    return policy == FIFO ? "fifo" : "lru";
+}
+
+bool VCacheSim::parsePolicy(const std::string &name, Policy &policy)
+{
+    if (name == "fifo")
+        policy = FIFO;
+    else if (name == "lru")
+        policy = LRU;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,68 @@
+#ifndef VCACHESIM_H
+#define VCACHESIM_H
+
+#include <vector>
+#include <string>
+#include "DLL.h"
+
+/*
+ * Post-transform vertex cache model to measure index buffers
+ *
+ * notes: FIFO keeps a stamp per vertex, a vertex hits while fewer than
+ *        cacheSize misses happened since it was loaded. LRU keeps the
+ *        cached vertices most recent first, cache sizes are small so a
+ *        linear search is cheaper than any index.
+ */
+class TRIDAG_LIB VCacheSim
+{
+public:
+    enum Policy { FIFO, LRU };
+
+    struct Stats
+    {
+        int     numTris;
+        int     numVerts; // distinct vertices referenced
+        int     misses;
+
+        float acmr() const; // average cache miss ratio, misses per triangle
+        float atvr() const; // average transform to vertex ratio, 1 is optimal
+    };
+
+private:
+    Policy              _policy;
+    int                 _cacheSize;
+    int                 _misses;
+    std::vector<int>    _stamps; // FIFO: vertexId to miss count when loaded, -1 if never
+    std::vector<int>    _entries; // LRU: cached vertexIds, most recent first
+
+public:
+    VCacheSim(Policy policy, int cacheSize);
+
+    void reset();
+    // true if vId is in the cache, it is loaded otherwise
+    bool access(int vId);
+    int getMisses() const;
+
+    // simulate indices from an empty cache
+    static Stats simulate(const std::vector<int> &indices, Policy policy, int cacheSize);
+    static const char* policyName(Policy policy);
+    // "fifo" or "lru", false if name is neither
+    static bool parsePolicy(const std::string &name, Policy &policy);
+};
+
+inline float VCacheSim::Stats::acmr() const
+{
+    return numTris ? (float)misses / numTris : 0.0f;
+}
+
+inline float VCacheSim::Stats::atvr() const
+{
+    return numVerts ? (float)misses / numVerts : 0.0f;
+}
+
+inline int VCacheSim::getMisses() const
+{
+    return _misses;
+}
+
+#endif // VCACHESIM_H
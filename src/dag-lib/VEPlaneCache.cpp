@@ -0,0 +1,52 @@
+#include "VEPlaneCache.h"
+#include <cstdint>
+
+// doubles per 64 bytes
+static const size_t ALIGN_DOUBLES = 8;
+
+VEPlaneCache::VEPlaneCache()
+    :_nTris(0)
+    ,_viewId(-1)
+    ,_stride(0)
+    ,_data(0)
+{
+}
+
+void VEPlaneCache::resize(int nTris)
+{
+    if (_data && nTris == _nTris)
+        return;
+    _nTris = nTris;
+    _viewId = -1;
+    _stride = ((size_t)nTris + ALIGN_DOUBLES - 1) / ALIGN_DOUBLES * ALIGN_DOUBLES;
+    // 3 edges x 3 components, plus room to align the start
+    _storage.assign(_stride * 9 + ALIGN_DOUBLES, 0.0);
+    uintptr_t p = (uintptr_t)_storage.data();
+    uintptr_t aligned = (p + 63) & ~(uintptr_t)63;
+    _data = _storage.data() + (aligned - p) / sizeof(double);
+}
+
+int VEPlaneCache::getViewId() const
+{
+    return _viewId;
+}
+
+void VEPlaneCache::setViewId(int viewId)
+{
+    _viewId = viewId;
+}
+
+int VEPlaneCache::getNumberOfTriangles() const
+{
+    return _nTris;
+}
+
+const Vector3d& VEPlaneCache::getPoint() const
+{
+    return _point;
+}
+
+void VEPlaneCache::setPoint(const Vector3d &point)
+{
+    _point = point;
+}
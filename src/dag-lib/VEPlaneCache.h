@@ -0,0 +1,66 @@
+#ifndef VEPLANECACHE_H
+#define VEPLANECACHE_H
+
+#include <vector>
+#include <cstddef>
+#include "DLL.h"
+#include "SFVector.h"
+
+/*
+ * Planes through a point view and each triangle edge
+ *
+ * notes: plane normals are stored as structure of arrays, one 64 byte
+ *        aligned array per edge and component (nx, ny, nz). All planes pass
+ *        through the view point, so it is kept once instead of a per plane
+ *        offset: tests take the dot product of (v - point) and the normal,
+ *        which stays accurate for view points far from the model. The buffer is owned by one worker
+ *        thread, allocated once and refilled for every view by
+ *        DagOccluder::preprocessVEMap.
+ */
+class TRIDAG_LIB VEPlaneCache
+{
+public:
+    enum PlaneComponent{
+        PC_NX = 0,
+        PC_NY,
+        PC_NZ,
+    };
+
+private:
+    int                     _nTris;
+    int                     _viewId;
+    Vector3d                _point;     // view point shared by all planes
+    size_t                  _stride;    // doubles between two arrays
+    std::vector<double>     _storage;
+    double                  *_data;     // _storage aligned to 64 bytes
+
+    VEPlaneCache(const VEPlaneCache&);
+    VEPlaneCache& operator=(const VEPlaneCache&);
+
+public:
+    VEPlaneCache();
+
+    void resize(int nTris); // no-op if the size doesn't change
+
+    int getViewId() const;
+    void setViewId(int viewId);
+    int getNumberOfTriangles() const;
+    const Vector3d& getPoint() const;
+    void setPoint(const Vector3d &point);
+
+    // array over triangles of one component of the plane normal of edge e
+    inline double* plane(int e, int c);
+    inline const double* plane(int e, int c) const;
+};
+
+inline double* VEPlaneCache::plane(int e, int c)
+{
+    return _data + (size_t)(e*3 + c) * _stride;
+}
+
+inline const double* VEPlaneCache::plane(int e, int c) const
+{
+    return _data + (size_t)(e*3 + c) * _stride;
+}
+
+#endif // VEPLANECACHE_H
@@ -0,0 +1,133 @@
+#include "ViewGrid.h"
+#include "Log.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// conservative padding of projected bounds
+static const double BOUND_PAD = 1e-7;
+// vertices closer than this along view direction are not projected
+static const double DEPTH_EPS = 1e-9;
+static const int MAX_GRID_RES = 256;
+
+ViewGrid::ViewGrid(const vector<Triangle> &triangles)
+    :_triangles(triangles)
+    ,_gridRes(1)
+    ,_originX(0)
+    ,_originY(0)
+    ,_cellSize(1)
+{
+    _bounds.resize(_triangles.size());
+}
+
+void ViewGrid::build(const Vector3d &point, const Vector3d &target, const int *triIds, int n)
+{
+    // view frame
+    Vector3d forward = (target - point).Normalized();
+    Vector3d helper = fabs(forward[2]) < 0.9 ? Vector3d(0,0,1) : Vector3d(1,0,0);
+    Vector3d right = (forward.Cross(helper)).Normalized();
+    Vector3d up = right.Cross(forward);
+
+    double minX = DBL_MAX, minY = DBL_MAX;
+    double maxX = -DBL_MAX, maxY = -DBL_MAX;
+    for (int k = 0; k < n; ++k) {
+        int triId = triIds[k];
+        const auto &tri = _triangles[triId];
+        Bound b{DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX};
+        bool behind = false;
+        for (const auto &v : tri._vertices) {
+            Vector3d dir = v - point;
+            double depth = dir.Dot(forward);
+            if (depth < DEPTH_EPS) {
+                behind = true;
+                break;
+            }
+            double x = dir.Dot(right) / depth;
+            double y = dir.Dot(up) / depth;
+            b.minX = std::min(b.minX, x);
+            b.minY = std::min(b.minY, y);
+            b.maxX = std::max(b.maxX, x);
+            b.maxY = std::max(b.maxY, y);
+        }
+        if (behind) {
+            // can't project, overlap with everything
+            _bounds[triId] = Bound{-DBL_MAX, -DBL_MAX, DBL_MAX, DBL_MAX};
+            continue;
+        }
+        b.minX -= BOUND_PAD;
+        b.minY -= BOUND_PAD;
+        b.maxX += BOUND_PAD;
+        b.maxY += BOUND_PAD;
+        _bounds[triId] = b;
+        minX = std::min(minX, b.minX);
+        minY = std::min(minY, b.minY);
+        maxX = std::max(maxX, b.maxX);
+        maxY = std::max(maxY, b.maxY);
+    }
+    if (minX > maxX) {
+        minX = minY = 0;
+        maxX = maxY = 1;
+    }
+
+    _gridRes = std::max(1, std::min(MAX_GRID_RES, (int)std::sqrt((double)n)));
+    _originX = minX;
+    _originY = minY;
+    _cellSize = std::max(maxX - minX, maxY - minY) / _gridRes;
+    if (_cellSize <= 0)
+        _cellSize = 1;
+
+    // bin triangles by counting sort
+    int nCells = _gridRes * _gridRes;
+    _cellStart.assign(nCells + 1, 0);
+    int x0, y0, x1, y1;
+    for (int k = 0; k < n; ++k) {
+        cellRange(_bounds[triIds[k]], x0, y0, x1, y1);
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+                _cellStart[y * _gridRes + x + 1]++;
+    }
+    for (int c = 0; c < nCells; ++c)
+        _cellStart[c + 1] += _cellStart[c];
+    _cellTris.resize(_cellStart[nCells]);
+    vector<int> fill(_cellStart.begin(), _cellStart.end() - 1);
+    for (int k = 0; k < n; ++k) {
+        cellRange(_bounds[triIds[k]], x0, y0, x1, y1);
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+                _cellTris[fill[y * _gridRes + x]++] = triIds[k];
+    }
+}
+
+void ViewGrid::cellRange(const Bound &b, int &x0, int &y0, int &x1, int &y1) const
+{
+    x0 = toCell(b.minX, _originX);
+    y0 = toCell(b.minY, _originY);
+    x1 = toCell(b.maxX, _originX);
+    y1 = toCell(b.maxY, _originY);
+}
+
+void ViewGrid::getCandidates(int triId, vector<int> &candidates) const
+{
+    candidates.clear();
+    const auto &b = _bounds[triId];
+    int x0, y0, x1, y1;
+    cellRange(b, x0, y0, x1, y1);
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            int cell = y * _gridRes + x;
+            for (int k = _cellStart[cell]; k < _cellStart[cell + 1]; ++k) {
+                int other = _cellTris[k];
+                if (other <= triId)
+                    continue;
+                const auto &ob = _bounds[other];
+                if (!overlap(b, ob))
+                    continue;
+                // report a pair only in the first cell both bounds share
+                if (x == std::max(x0, toCell(ob.minX, _originX))
+                        && y == std::max(y0, toCell(ob.minY, _originY)))
+                    candidates.push_back(other);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+}
@@ -0,0 +1,64 @@
+#ifndef VIEWGRID_H
+#define VIEWGRID_H
+
+#include <vector>
+#include "SFVector.h"
+#include "GraphCommon.h"
+#include "DLL.h"
+
+/*
+ * Broad phase for occlusion test of a point view
+ *
+ * notes: triangles are projected to the image plane of the view and their
+ *        2D bounds are binned into a uniform grid. Two triangles whose
+ *        projected bounds don't overlap are separated by a plane through
+ *        the view point, so they never reach the exact occlusion test.
+ *        Queries don't modify the grid, so the row blocks of one view can
+ *        share it across threads.
+ */
+class TRIDAG_LIB ViewGrid
+{
+    struct Bound{
+        double minX, minY, maxX, maxY;
+    };
+
+    const vector<Triangle>  &_triangles;
+    int                     _gridRes;   // cells along one side
+    double                  _originX;
+    double                  _originY;
+    double                  _cellSize;
+    vector<Bound>           _bounds;    // from triId to projected bound
+    vector<int>             _cellStart; // cell to its range in _cellTris
+    vector<int>             _cellTris;  // triIds binned by cell
+
+protected:
+    inline bool overlap(const Bound &a, const Bound &b) const;
+    inline int toCell(double v, double origin) const;
+    void cellRange(const Bound &b, int &x0, int &y0, int &x1, int &y1) const;
+
+public:
+    ViewGrid(const vector<Triangle> &triangles);
+
+    // project triIds[0..n) as seen from point looking at target and bin them
+    void build(const Vector3d &point, const Vector3d &target, const int *triIds, int n);
+    // triangles with id > triId whose projection may overlap triId, sorted
+    void getCandidates(int triId, vector<int> &candidates) const;
+};
+
+inline bool ViewGrid::overlap(const Bound &a, const Bound &b) const
+{
+    return a.minX <= b.maxX && b.minX <= a.maxX
+            && a.minY <= b.maxY && b.minY <= a.maxY;
+}
+
+inline int ViewGrid::toCell(double v, double origin) const
+{
+    double c = (v - origin) / _cellSize;
+    if (c <= 0)
+        return 0;
+    if (c >= _gridRes - 1)
+        return _gridRes - 1;
+    return (int)c;
+}
+
+#endif // VIEWGRID_H
@@ -1,4 +1,11 @@
 #include "appcommon.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
 
 void initLogging(std::string appname) {
     lg::register_simple_formatter_factory< boost::log::trivial::severity_level, char >("Severity");
@@ -48,3 +55,22 @@ std::string getCacheDir(
 
     return cacheDir.string();
 }
+
+size_t getPeakMemoryMB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize >> 20;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss >> 20; // bytes
+#else
+    return (size_t)usage.ru_maxrss >> 10; // KB
+#endif
+#endif
+}
@@ -17,4 +17,7 @@ TRIDAG_LIB void toggleDebug(bool debug);
 
 TRIDAG_LIB std::string getCacheDir(std::string rootDir, std::string model, int sub, double epsi,double nearScale,int interLevel);
 
+// peak resident memory of this process in MB so far, 0 if it can't be read
+TRIDAG_LIB size_t getPeakMemoryMB();
+
 #endif // APPCOMMON_H
@@ -16,12 +16,13 @@ build_pass:CONFIG(debug, debug|release):{
     LIBS += -L$$PWD/../../thirdparty/boost/release
 }
 win32-msvc* : QMAKE_LFLAGS += /INCREMENTAL:NO
+win32-g++ : LIBS += -lpsapi
 
 INCLUDEPATH += $$PWD/../../
 INCLUDEPATH += $(BOOST_HOME)
 
 msvc {
-  QMAKE_CXXFLAGS += -openmp -arch:AVX -D "_CRT_SECURE_NO_WARNINGS"
+  QMAKE_CXXFLAGS += -openmp -arch:AVX2 -D "_CRT_SECURE_NO_WARNINGS"
   QMAKE_CXXFLAGS_RELEASE *= -O2
 }
 
@@ -31,14 +32,23 @@ SOURCES += \
     DAG.cpp \
     DAGCenter.cpp \
     DagGraph.cpp \
+    DagCSR.cpp \
+    DagCache.cpp \
     GraphCommon.cpp \
     Occluder.cpp \
+    OccluderSIMD.cpp \
+    RelationTable.cpp \
     ViewBase.cpp \
     ViewFacet.cpp \
     ViewPoint.cpp \
+    ViewGrid.cpp \
+    VEPlaneCache.cpp \
     ModelBase.cpp \
     DagMerger.cpp \
+    EdgeQueue.cpp \
     SampledTriangle.cpp \
+    TaskScheduler.cpp \
+    VCacheSim.cpp \
     InitViewModel.cpp
 	
 HEADERS += \
@@ -47,14 +57,22 @@ HEADERS += \
     DAG.h \
     DAGCenter.h \
     DagGraph.h \
+    DagCSR.h \
+    DagCache.h \
     GraphCommon.h \
     Occluder.h \
+    RelationTable.h \
     ViewBase.h \
     ViewFacet.h \
     ViewPoint.h \
+    ViewGrid.h \
+    VEPlaneCache.h \
     ModelBase.h \
     DagMerger.h \
+    EdgeQueue.h \
     SampledTriangle.h \
+    TaskScheduler.h \
+    VCacheSim.h \
     SFMath.h \
     SFVector.h \
     Log.h \
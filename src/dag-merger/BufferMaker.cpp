@@ -2,8 +2,12 @@
 #include "dag-lib/Log.h"
 #include "dag-lib/ViewPoint.h"
 #include "dag-lib/ViewFacet.h"
+#include "dag-lib/VCacheSim.h"
 #include <time.h>
 #include <random>
+#include <chrono>
+#include <algorithm>
+#include <unordered_set>
 #include <boost/filesystem.hpp>
 #include <boost/serialization/serialization.hpp>
 #include<boost/serialization/unordered_map.hpp>
@@ -13,6 +17,7 @@
 #include <fstream>
 #include <time.h>
 #include <math.h>
+#include <omp.h>
 
 namespace fs = boost::filesystem;
 
@@ -20,6 +25,8 @@ BufferMaker::BufferMaker(ModelBase* pModel, DAGCenter* pDagCenter)
     :_pModel(pModel)
     ,_pDagCenter(pDagCenter)
     ,_pViewModel(0)
+    ,_pDagMerger(0)
+    ,_metric(1)
 {
 }
 
@@ -28,9 +35,6 @@ BufferMaker::~BufferMaker()
     if (_pDagMerger)
         delete _pDagMerger;
 
-    if (_dagFanVCache)
-        delete _dagFanVCache;
-
     if (_pViewModel)
         delete _pViewModel;
 }
@@ -41,47 +45,115 @@ void BufferMaker::init(int nSplit, int metric)
     auto radius = _pModel->getRadius();
     _pViewModel = new SFViewFacet(center, 3.0*radius, nSplit);
     _pViewModel->initViewNodes();
-
-    auto nDags = _pViewModel->getNumberOfNodes();
-    _pDagMerger = new DAGMerger(nDags, _pDagCenter,_pViewModel,metric);
+    _metric = metric;
 }
 
-void BufferMaker::merge()
+void BufferMaker::merge(bool parallel, int numThreads)
 {
+    if (!_pDagMerger) {
+        auto nDags = _pViewModel->getNumberOfNodes();
+        _pDagMerger = new DAGMerger(nDags, _pDagCenter,_pViewModel,_metric);
+    }
     while( _pDagMerger->hasQueue() ) {
-        _pDagMerger->mergeTop();
+        if (parallel)
+            _pDagMerger->mergeRound(numThreads);
+        else
+            _pDagMerger->mergeTop();
     }
 
     _pDagMerger->showResult();
 }
 
-void BufferMaker::updateClusters()
+// expected number of clusters a relaxation around clusterId removes:
+// small clusters in it and its 1-ring are the ones likely to be emptied
+double BufferMaker::_relaxScore(int clusterId) const
 {
-    int nNodes = _pViewModel->getNumberOfNodes();
-    _pDagMerger->updateClusterNbs(_pViewModel->getViewEdges());
-
-    std::default_random_engine generator(std::time(0));
-    std::uniform_int_distribution<unsigned> distribution(0,nNodes-1);
-    int dagId = (int) distribution(generator);
-
-    int clusterId = _pDagMerger->getClusterId(dagId);
-    auto clusterNbs = _pDagMerger->getClusterNb(clusterId);
-    clusterNbs.insert(clusterId);
-
-    gLogInfo<<"relax cluster "<<clusterId;
-    // ship from 1-ring to 2-ring
-    for(auto cluster :clusterNbs){
-        if(cluster == clusterId)
-            continue;
-        std::unordered_map<int, std::set<int>> ignoreClusters;
-        while(_pDagMerger->shipBoundDag(cluster,clusterNbs, ignoreClusters)){}
-    }
-    // ship from center to 1-ring neighbor
-    std::set<int> temp{clusterId};
-    std::unordered_map<int, std::set<int>> ignoreClusters;
-    while(_pDagMerger->shipBoundDag(clusterId,temp,ignoreClusters)){}
+    double score = 1.0 / std::max(1, _pDagMerger->getClusterSize(clusterId));
+    for(auto nb : _pDagMerger->getClusterNb(clusterId))
+        score += 1.0 / std::max(1, _pDagMerger->getClusterSize(nb));
+    return score;
+}
+
+void BufferMaker::relaxClusters(int maxRounds, double timeBudget, unsigned seed, int numThreads)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    auto outOfTime = [&]() {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        return timeBudget > 0 && elapsed.count() >= timeBudget;
+    };
+    std::mt19937 generator(seed);
+
+    for(int round = 0; round < maxRounds && !outOfTime(); round++){
+        int oldNClusters = getNClusters();
+        _pDagMerger->updateClusterNbs(_pViewModel->getViewEdges());
+
+        // every cluster is a center once a round, best expected reduction first
+        auto centers = _pDagMerger->getClusterIds();
+        std::sort(centers.begin(), centers.end());
+        std::shuffle(centers.begin(), centers.end(), generator);
+        vector<std::pair<double,int>> scored;
+        for(auto clusterId : centers)
+            scored.push_back(std::make_pair(_relaxScore(clusterId), clusterId));
+        std::stable_sort(scored.begin(), scored.end(),
+                         [](const std::pair<double,int>& a, const std::pair<double,int>& b){
+                             return a.first > b.first;
+                         });
+        centers.clear();
+        for(const auto& s : scored)
+            centers.push_back(s.second);
 
-    _pDagMerger->cleanEmpty(clusterNbs);
+        // waves of centers whose 2-rings don't meet the 3-rings of the others.
+        // A relaxation changes its 2-ring and reads the assignments of its 3-ring
+        // to update boundaries, so a wave runs in parallel and gives the same
+        // result as in order
+        while(!centers.empty() && !outOfTime()){
+            std::unordered_set<int> blocked;
+            vector<int> wave, rest;
+            for(auto clusterId : centers){
+                if(_pDagMerger->getClusterSize(clusterId) == 0)
+                    continue;
+                std::set<int> ring{clusterId};
+                for(auto nb : _pDagMerger->getClusterNb(clusterId)){
+                    ring.insert(nb);
+                    auto nbs = _pDagMerger->getClusterNb(nb);
+                    ring.insert(nbs.begin(), nbs.end());
+                }
+                bool free = true;
+                for(auto c : ring)
+                    if(blocked.count(c)){
+                        free = false;
+                        break;
+                    }
+                if(!free){
+                    rest.push_back(clusterId);
+                    continue;
+                }
+                blocked.insert(ring.begin(), ring.end());
+                for(auto c : ring){
+                    auto nbs = _pDagMerger->getClusterNb(c);
+                    blocked.insert(nbs.begin(), nbs.end());
+                }
+                wave.push_back(clusterId);
+            }
+
+            gLogDebug<<"relax wave of "<<wave.size()<<" clusters";
+            _pDagMerger->prefetchRelax(wave);
+#pragma omp parallel for schedule(dynamic,1) num_threads(numThreads)
+            for(int k = 0; k < (int)wave.size(); k++)
+                _pDagMerger->relaxCluster(wave[k]);
+            _pDagCenter->trim();
+
+            // neighbors changed with the shipped dags
+            _pDagMerger->removeEmptyClusters();
+            _pDagMerger->updateClusterNbs(_pViewModel->getViewEdges());
+            centers.swap(rest);
+        }
+
+        int nClusters = getNClusters();
+        gLogInfo<<"relax round "<<round<<": "<<oldNClusters<<" -- "<<nClusters;
+        if(nClusters == oldNClusters)
+            break;
+    }
 }
 
 int BufferMaker::getNClusters()
@@ -89,10 +161,14 @@ int BufferMaker::getNClusters()
     return _pDagMerger->getNumberOfClusters();
 }
 
-void BufferMaker::saveAssign(string cacheDir) const
+bool BufferMaker::saveAssign(string cacheDir) const
 {
     string fileName = cacheDir +"/assignments.txt";
     ofstream ofs(fileName);
+    if(!ofs.is_open()){
+        gLogError<<"Failed to save assignments "<<fileName;
+        return false;
+    }
 
     auto assigns = _pDagMerger->getAssignments();
 
@@ -112,42 +188,139 @@ void BufferMaker::saveAssign(string cacheDir) const
             ofs<< assigns[k]<<" "<< theta<<" "<<phi;
     }
     ofs.close();
+    if(!ofs){
+        gLogError<<"Failed to save assignments "<<fileName;
+        return false;
+    }
+    return true;
+}
+
+bool BufferMaker::saveClusters(string fileName) const
+{
+    auto assigns = _pDagMerger->getAssignments();
+    ofstream ofs(fileName);
+    ofs<<assigns.size()<<endl;
+    for(auto clusterId : assigns)
+        ofs<<clusterId<<endl;
+    ofs.close();
+    if(!ofs){
+        gLogError<<"Failed to save clusters "<<fileName;
+        return false;
+    }
+    return true;
+}
+
+bool BufferMaker::loadClusters(string fileName)
+{
+    ifstream ifs(fileName);
+    size_t nNodes = 0;
+    if(!(ifs>>nNodes)){
+        gLogError<<"Failed to load clusters "<<fileName;
+        return false;
+    }
+    vector<int> assigns(nNodes);
+    for(auto &clusterId : assigns)
+        if(!(ifs>>clusterId)){
+            gLogError<<"Failed to load clusters "<<fileName;
+            return false;
+        }
+    if(_pDagMerger)
+        return _pDagMerger->setAssignments(assigns);
+
+    auto nDags = _pViewModel->getNumberOfNodes();
+    _pDagMerger = new DAGMerger(nDags, _pDagCenter, _pViewModel, _metric, false);
+    if(_pDagMerger->setAssignments(assigns))
+        return true;
+    // merge() starts over from single dag clusters
+    delete _pDagMerger;
+    _pDagMerger = 0;
+    return false;
 }
 
 //  DAGMerger need add getClusterIds
 //  DAGMerger move getClusterDag to public
 //  DAGMerger add clean clusterDag
-void BufferMaker::vCacheOrder(string outDir)
+bool BufferMaker::vCacheOrder(string outDir, int numThreads, DagVCacheOrder::Method method, int cacheSize)
 {
-    _dagFanVCache = new DagFanVCache(_pModel->getNumberOfVertices(),_pModel->getNumberOfTriangles(),20);
+    // the mesh part is shared, each thread orders its clusters with its own state
+    const auto &indices = _pModel->getIndices();
+    VertexTriAdjacency adjTris(_pModel->getNumberOfVertices(), indices);
+    vector<std::unique_ptr<DagVCacheOrder>> vCacheOrders(std::max(1, numThreads));
+    for(auto &vCacheOrder : vCacheOrders)
+        vCacheOrder.reset(DagVCacheOrder::create(method, &adjTris, _pModel->getNumberOfTriangles(), cacheSize));
+    // every buffer is measured with both cache models, so the methods can be compared
+    const VCacheSim::Policy policies[2] = {VCacheSim::FIFO, VCacheSim::LRU};
 
+    // cluster ids come in hash order, sorted the stats don't depend on merge history
     vector<int> clusterIds = _pDagMerger->getClusterIds();
-    for(auto clusterId : clusterIds){
-        this->_vCacheOrder(clusterId, outDir);
+    std::sort(clusterIds.begin(), clusterIds.end());
+    vector<VCacheSim::Stats> stats(clusterIds.size() * 2);
+    vector<char> saved(clusterIds.size(), 0);
+#pragma omp parallel for schedule(dynamic,1) num_threads(numThreads)
+    for(int k = 0; k < (int)clusterIds.size(); k++){
+        vector<int> newIndices;
+        saved[k] = this->_vCacheOrder(clusterIds[k], outDir, *vCacheOrders[omp_get_thread_num()], indices, newIndices);
+        for(int p = 0; p < 2; p++)
+            stats[k*2+p] = VCacheSim::simulate(newIndices, policies[p], cacheSize);
         //_pDagMerger->clearClusterDag(clusterId);
     }
+
+    // cluster tris verts, then misses acmr atvr of fifo and of lru
+    string fileName = outDir +"/vcache_stats.txt";
+    std::ofstream fout(fileName);
+    fout<<"# "<<DagVCacheOrder::methodName(method)<<" "<<cacheSize<<" "
+        <<VCacheSim::policyName(policies[0])<<" "<<VCacheSim::policyName(policies[1])<<std::endl;
+    VCacheSim::Stats total[2] = {{0, 0, 0}, {0, 0, 0}};
+    for(int k = 0; k < (int)clusterIds.size(); k++){
+        const auto &fifo = stats[k*2];
+        const auto &lru = stats[k*2+1];
+        gLogInfo<<"buffer "<<clusterIds[k]<<" acmr "<<fifo.acmr()<<" / "<<lru.acmr()
+                <<" atvr "<<fifo.atvr()<<" / "<<lru.atvr();
+        fout<<clusterIds[k]<<" "<<fifo.numTris<<" "<<fifo.numVerts;
+        for(int p = 0; p < 2; p++){
+            const auto &st = stats[k*2+p];
+            fout<<" "<<st.misses<<" "<<st.acmr()<<" "<<st.atvr();
+            total[p].numTris += st.numTris;
+            total[p].numVerts += st.numVerts;
+            total[p].misses += st.misses;
+        }
+        fout<<std::endl;
+    }
+    fout.close();
+    for(int p = 0; p < 2; p++)
+        gLogInfo<<DagVCacheOrder::methodName(method)<<" on "<<VCacheSim::policyName(policies[p])<<" "<<cacheSize
+                <<": acmr "<<total[p].acmr()<<" atvr "<<total[p].atvr();
+    if(!fout){
+        gLogError<<"Failed to save "<<fileName;
+        return false;
+    }
+    return std::find(saved.begin(), saved.end(), 0) == saved.end();
 }
 
-void BufferMaker::_vCacheOrder(int clusterId, string outDir)
+bool BufferMaker::_vCacheOrder(int clusterId, string outDir, DagVCacheOrder &vCacheOrder, const vector<int> &indices,
+                               vector<int> &newIndices)
 {
     // compute DAG
     // Given a occlude b
     // change to b--> a from a --> b
+    // reverted edges are added in sorted order, so the order only depends on
+    // the edges and not on how the cluster dag was built (merged or resumed)
     auto clusterDag = _pDagMerger->getClusterDag(clusterId);
-    auto occGraph = clusterDag->getDagGraph();
-    auto occMap = occGraph.getDagMap();
+    auto occGraph = clusterDag->getDagGraph().getCSR();
+    vector<std::pair<uint64_t,int>> revertEdges;
+    for(int v = 0;v < occGraph->getNumberOfVertices();v++){
+        for(auto k = occGraph->rowBegin(v);k < occGraph->rowEnd(v);k++)
+            revertEdges.push_back(std::make_pair(DagCSR::packEdge(occGraph->target(k), v), occGraph->count(k)));
+    }
+    std::sort(revertEdges.begin(), revertEdges.end());
 
     DagGraph tempGraph;
-    for(auto it = occMap.cbegin();it!= occMap.cend();it++){
-        for(auto innerIt = occMap.at(it->first).cbegin();innerIt != occMap.at(it->first).cend();innerIt++){
-            tempGraph.addEdge(innerIt->first,it->first,innerIt->second);
-        }
-    }
+    for(const auto &edge : revertEdges)
+        tempGraph.addEdge(DagCSR::edgeSource(edge.first),DagCSR::edgeTarget(edge.first),edge.second);
     auto revertMap = tempGraph.getDagMap();
 
-    auto oldIndices = _pModel->getIndices();
-    _dagFanVCache->init(revertMap,oldIndices);
-    auto newIndices = _dagFanVCache->sort(oldIndices);
+    vCacheOrder.init(revertMap);
+    newIndices = vCacheOrder.sort(indices);
     //log the indices out and render to see the result
     //save the indices
     string fileName = outDir +"/Indices_"+to_string(clusterId)+".txt";
@@ -156,13 +329,23 @@ void BufferMaker::_vCacheOrder(int clusterId, string outDir)
     for(auto vid : newIndices)
         fout<<vid<<std::endl;
     fout.close();
+    if(!fout){
+        gLogError<<"Failed to save "<<fileName;
+        return false;
+    }
 
     //save the triOrder used in order-upsample
-    auto triOrders = _dagFanVCache->getTriOrder();
+    auto triOrders = vCacheOrder.getTriOrder();
     fileName = outDir +"/triOrder_"+to_string(clusterId)+".txt";
     gLogInfo<<"save "<<fileName;
+    fout.clear();
     fout.open(fileName);
     for(auto triId : triOrders)
         fout<<triId<<std::endl;
     fout.close();
+    if(!fout){
+        gLogError<<"Failed to save "<<fileName;
+        return false;
+    }
+    return true;
 }
@@ -5,7 +5,7 @@
 #include "dag-lib/DAGCenter.h"
 #include "dag-lib/DagMerger.h"
 #include "dag-lib/SampledTriangle.h"
-#include "DAGFanVCache.h"
+#include "DAGVCacheOrder.h"
 #include "dag-lib/DAGCenter.h"
 
 class BufferMaker
@@ -15,22 +15,36 @@ private:
     DAGCenter                             *_pDagCenter;
     SFViewBase                           *_pViewModel;
 
-    DAGMerger                           *_pDagMerger;
-    DagFanVCache                          *_dagFanVCache;
+    DAGMerger                           *_pDagMerger; // built by merge or loadClusters
+    int                                  _metric;
 protected:
-    void _vCacheOrder(int clusterId, string cacheDir);
+    // return the ordered indices
+    // false if the Indices or triOrder file of the cluster can't be written
+    bool _vCacheOrder(int clusterId, string cacheDir, DagVCacheOrder &vCacheOrder, const vector<int> &indices,
+                      vector<int> &newIndices);
+    double _relaxScore(int clusterId) const;
 public:
     BufferMaker(ModelBase* pModel, DAGCenter* pDagCenter);
     ~BufferMaker();
 
     void init(int nSplit, int metric);
 
-    void merge();
-    void updateClusters();
-    // save assignments
-    void saveAssign(string cacheDir) const;
-    // vertex cache optimize
-    void vCacheOrder(string outDir);
+    // parallel merges rounds of independent cluster pairs on numThreads threads
+    void merge(bool parallel = false, int numThreads = 1);
+    // relax cluster borders for at most maxRounds rounds, until a round removes
+    // no cluster or timeBudget seconds (0 for no limit) are spent
+    void relaxClusters(int maxRounds, double timeBudget = 0, unsigned seed = 0, int numThreads = 1);
+    // save assignments, false if the file can't be written
+    bool saveAssign(string cacheDir) const;
+    // checkpoint of the clusters, see DAGMerger::setAssignments
+    bool saveClusters(string fileName) const;
+    // before merge() the clusters are restored without building the merge queue
+    bool loadClusters(string fileName);
+    // vertex cache optimize, clusters are ordered on numThreads threads.
+    // ACMR/ATVR of each buffer under FIFO and LRU caches are saved to vcache_stats.txt.
+    // false if a buffer or the stats can't be written
+    bool vCacheOrder(string outDir, int numThreads = 1,
+                     DagVCacheOrder::Method method = DagVCacheOrder::FAN, int cacheSize = 20);
 
     int getNClusters();
 };
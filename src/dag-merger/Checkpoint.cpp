@@ -0,0 +1,58 @@
+#include "Checkpoint.h"
+#include "dag-lib/Log.h"
+#include <fstream>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+Checkpoint::Checkpoint(std::string cacheDir)
+{
+    if (cacheDir.empty())
+        return;
+    _fileName = (fs::path(cacheDir) / "checkpoint.txt").string();
+
+    std::ifstream ifs(_fileName);
+    std::string line;
+    while (std::getline(ifs, line)) {
+        auto tab = line.find('\t');
+        if (tab != std::string::npos)
+            _keys[line.substr(0, tab)] = line.substr(tab + 1);
+    }
+}
+
+bool Checkpoint::isDone(const std::string &phase, const std::string &key) const
+{
+    auto it = _keys.find(phase);
+    return it != _keys.end() && it->second == key;
+}
+
+void Checkpoint::setDone(const std::string &phase, const std::string &key)
+{
+    if (_fileName.empty())
+        return;
+    _keys[phase] = key;
+
+    std::string tempName = _fileName + ".tmp";
+    std::ofstream ofs(tempName);
+    for (const auto &it : _keys)
+        ofs << it.first << '\t' << it.second << std::endl;
+    ofs.close();
+    if (!ofs) {
+        gLogError << "Failed to write checkpoint " << tempName;
+        return;
+    }
+    boost::system::error_code ec;
+    fs::rename(tempName, _fileName, ec);
+    if (ec)
+        gLogError << "Failed to write checkpoint " << _fileName << " - " << ec.message();
+}
+
+std::string Checkpoint::fileKey(const std::string &fileName)
+{
+    boost::system::error_code ec;
+    fs::path path = fs::absolute(fileName);
+    std::ostringstream oss;
+    oss << path.string() << " " << fs::file_size(path, ec) << " " << fs::last_write_time(path, ec);
+    return oss.str();
+}
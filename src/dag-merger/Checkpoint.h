@@ -0,0 +1,31 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+#include <map>
+
+/*
+ * Finished phases of a dag-merger run in a cache dir
+ *
+ * notes: checkpoint.txt keeps one line per finished phase with the key of
+ *        the inputs it was computed from. A phase is done only while its key
+ *        matches, keys of later phases contain the keys of earlier ones so
+ *        a changed input redoes everything after it.
+ */
+class Checkpoint
+{
+    std::string                         _fileName; // empty without a cache dir
+    std::map<std::string, std::string>  _keys; // phase to key
+
+public:
+    Checkpoint(std::string cacheDir);
+
+    bool isDone(const std::string &phase, const std::string &key) const;
+    // record the phase, the file is replaced at once so a crash keeps the old one
+    void setDone(const std::string &phase, const std::string &key);
+
+    // model path, size and write time, so a changed model is noticed
+    static std::string fileKey(const std::string &fileName);
+};
+
+#endif // CHECKPOINT_H
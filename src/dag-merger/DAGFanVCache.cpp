@@ -1,58 +1,51 @@
 #include "DAGFanVCache.h"
 #include "dag-lib/Log.h"
 
-DagFanVCache::DagFanVCache(int numVerts,int numTris,int cacheSize)
-    :_numVerts(numVerts)
+DagFanVCache::DagFanVCache(const VertexTriAdjacency* adjTris,int numTris,int cacheSize)
+    :_adjTris(adjTris)
     ,_numTris(numTris)
-    ,_cacheSize(cacheSize)
+    ,_numVerts(adjTris->getNumberOfVertices())
     ,_cachePos(cacheSize)
+    ,_cacheSize(cacheSize)
+    ,_occMap(0)
 {
 }
 
-// old indices or our bfs indices
-void DagFanVCache::init(const DagMap& occMap,const vector<int> &indices)
+// only the per cluster state is reset, the adjacency is shared
+void DagFanVCache::init(const DagMap& occMap)
 {
     _cachePos = _cacheSize;
-    _occMap = occMap;
-
-    _actiTris.clear();
-    _inDegrees.clear();
-    _inDegrees.resize(_numTris,0);
-    for(auto it = _occMap.cbegin();it != _occMap.cend();it++){
-        _actiTris.insert(it->first);
-        for(auto innerIt = _occMap.at(it->first).cbegin();innerIt != _occMap.at(it->first).cend();innerIt++){
-            _actiTris.insert(innerIt->first);
-            _inDegrees[innerIt->first] ++;
-        }
-    }
+    _occMap = &occMap;
 
     //only set the active tri as available
-    _triStatus.clear();
-    _triStatus.resize(_numTris,0);
-    for(auto id : _actiTris)
-        _triStatus[id] = 1;
-
-    _remValence.clear();
-    _adjTris.clear();
-    _remValence.resize(_numVerts,0);
-    vector<int> emptyV;
-    for(int i=0;i<_numVerts;i++)
-        _adjTris[i] = emptyV;
-    for(int i=0;i<indices.size()/3;i++){
-        for(int j=0;j<3;j++){
-            auto vId = indices[i*3+j];
-            _adjTris.at(vId).push_back(i);
-            _remValence[vId]++;
+    _inDegrees.assign(_numTris,0);
+    _triStatus.assign(_numTris,0);
+    for(auto it = occMap.cbegin();it != occMap.cend();it++){
+        _triStatus[it->first] = 1;
+        for(auto innerIt = it->second.cbegin();innerIt != it->second.cend();innerIt++){
+            _triStatus[innerIt->first] = 1;
+            _inDegrees[innerIt->first] ++;
         }
     }
+    _remTris = 0;
+    for(auto status : _triStatus)
+        _remTris += status;
+    // ready tris are counted in sort, they need the indices
+    _liveTris.assign(_numVerts,0);
+    _readyTris = std::priority_queue<int,vector<int>,std::greater<int>>();
+
+    _remValence.resize(_numVerts);
+    for(int i=0;i<_numVerts;i++)
+        _remValence[i] = _adjTris->valence(i);
 
-    _cacheStamp.clear();
-    _cacheStamp.resize(_numVerts,-1);
+    _cacheStamp.assign(_numVerts,-1);
     _indicesOut.clear();
     _indicesOut.reserve(_numTris*3);
 
     _triOrderOut.clear();
     _triOrderOut.reserve(_numTris);
+    // candidates of the previous cluster
+    _startTailList.clear();
 }
 
 bool DagFanVCache::insideCache(int vId)
@@ -67,18 +60,46 @@ bool DagFanVCache::insideCache(int vId)
         return true;
 }
 
-void DagFanVCache::updateInDeg(int id)
+void DagFanVCache::updateInDeg(int id,const vector<int>& indices)
 {
-    if(_occMap.find(id) != _occMap.end()){
-        for(auto it = _occMap.at(id).cbegin();it!= _occMap.at(id).cend();it++){
+    auto occIt = _occMap->find(id);
+    if(occIt != _occMap->end()){
+        for(auto it = occIt->second.cbegin();it!= occIt->second.cend();it++){
             _inDegrees[it->first] --;
             if(_inDegrees[it->first] < 0){
                 gLogError<<"inDegree Error!";
             }
+            else if(checkTri(it->first))
+                setReady(it->first,indices);
         }
     }
 }
 
+void DagFanVCache::setReady(int triId,const vector<int>& indices)
+{
+    _readyTris.push(triId);
+    for(int j=0;j<3;j++)
+        _liveTris[indices[triId*3+j]]++;
+}
+
+void DagFanVCache::emitTri(int triId,const vector<int>& indices)
+{
+    _triStatus[triId] = 0;
+    _remTris--;
+    for(int j=0;j<3;j++)
+        _liveTris[indices[triId*3+j]]--;
+    //add update inDegree
+    updateInDeg(triId,indices);
+}
+
+int DagFanVCache::minReadyTri()
+{
+    // emitted tris are dropped when they reach the top
+    while(!_readyTris.empty() && !checkTri(_readyTris.top()))
+        _readyTris.pop();
+    return _readyTris.empty() ? -1 : _readyTris.top();
+}
+
 
 void DagFanVCache::fanTop(int vId,const vector<int>& indices)
 {
@@ -87,15 +108,14 @@ void DagFanVCache::fanTop(int vId,const vector<int>& indices)
     int bestemitted = -INT_MAX;
     int cachePosFan = _cachePos;
     next = -1;
-    for(auto triId : _adjTris.at(vId)){
+    for(auto p = _adjTris->trisBegin(vId);p != _adjTris->trisEnd(vId);p++){
+        auto triId = *p;
        // gLogInfo<<"tri "<<triId<<" degree "<<_inDegrees[triId];
         //add check inDegree
         if(checkTri(triId)){
             //gLogInfo<<"emit tri "<<triId;
             _triOrderOut.push_back(triId);
-            //add update inDegree
-            updateInDeg(triId);
-            _triStatus[triId] = 0;
+            emitTri(triId,indices);
             for(auto j=0;j<3;j++){
                 auto id = indices[triId*3+j];
                 _indicesOut.push_back(id);
@@ -118,33 +138,18 @@ void DagFanVCache::fanTop(int vId,const vector<int>& indices)
         }
     }
     //gLogInfo<<"result";
-    for(auto triId : _adjTris.at(vId)){
-        //gLogInfo<<"tri "<<triId<<" degree "<<_inDegrees[triId]<<" status "<<_triStatus[triId];
-    }
     //getchar();
 }
-int DagFanVCache::numActiTris(int vId)
-{
-    int sum =0;
-    for(auto triId:_adjTris.at(vId)){
-        if(checkTri(triId))
-            sum++;
-    }
-    return sum;
-}
 
+// ties go to the lowest vertex id. The map based version went by hash
+// order, so the two may pick different vertices; chooseVert doesn't call it
 int DagFanVCache::firstChoose()
 {
     int bestCount =0;
-    int vertId;
-
-    for(auto it : _adjTris){
-        auto vId = it.first;
-        int count =0;
-        for(auto triId : it.second ){
-            if(checkTri(triId))
-                count ++;
-        }
+    int vertId = -1;
+
+    for(int vId=0;vId<_numVerts;vId++){
+        int count = numActiTris(vId);
         if(count > bestCount){
             vertId = vId;
             bestCount = count;
@@ -159,10 +164,9 @@ int DagFanVCache::chooseVert(const vector<int>& indices)
 {
     //nothing in cache
     if(_cachePos == _cacheSize){
-        for(int triId=0;triId <_numTris;triId++){
-            if(checkTri(triId))
-                return indices[triId*3];
-        }
+        int triId = minReadyTri();
+        if(triId != -1)
+            return indices[triId*3];
         //return firstChoose();
     }
     //gLogInfo<<"next "<<next;
@@ -179,10 +183,9 @@ int DagFanVCache::chooseVert(const vector<int>& indices)
             }
         }
         if(notFind){
-            for(int triId=0;triId <_numTris;triId++){
-                if(checkTri(triId))
-                    return indices[triId*3];
-            }
+            int triId = minReadyTri();
+            if(triId != -1)
+                return indices[triId*3];
         }
     }
     else{
@@ -192,18 +195,18 @@ int DagFanVCache::chooseVert(const vector<int>& indices)
     return -1;
 }
 
-bool DagFanVCache::checkFinish()
-{
-    int sum=0;
-    for(auto v: _triStatus)
-        sum += v;
-    return sum == 0 ? true : false;
-}
-
 vector<int> DagFanVCache::sort(const vector<int> &indices)
 {
+    for(int triId=0;triId<_numTris;triId++){
+        if(checkTri(triId))
+            setReady(triId,indices);
+    }
     while(!checkFinish()){
         auto vId = chooseVert(indices);
+        if(vId == -1){
+            gLogError<<"no ready triangle, "<<_remTris<<" triangles are in a cycle";
+            break;
+        }
         fanTop(vId,indices);
     }
      //float acmr = (float)(_cachePos - _cacheSize)/_numTris;
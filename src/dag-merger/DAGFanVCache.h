@@ -1,13 +1,24 @@
 #ifndef DAGFANVCACHE_H
 #define DAGFANVCACHE_H
 
-#include "dag-lib/DagGraph.h"
+#include "DAGVCacheOrder.h"
 #include <set>
 #include <unordered_map>
 #include <deque>
+#include <queue>
+#include <functional>
 
-class DagFanVCache
+/*
+ * Vertex cache order of the triangles of a cluster by fans, FIFO cache model
+ *
+ * notes: fans around a vertex while the DAG of the cluster allows. A
+ *        triangle is ready when it is active and its in-degree is 0. Ready
+ *        triangles are kept in a min heap and counted per vertex as they
+ *        change, so no step scans all triangles
+ */
+class DagFanVCache : public DagVCacheOrder
 {
+    const VertexTriAdjacency                    *_adjTris;//from vertexId to adjTris, shared
     int                                          _numTris;
     int                                          _numVerts;
     int                                          _cachePos;
@@ -16,11 +27,12 @@ class DagFanVCache
     vector<int>                                  _inDegrees;// from triId to indegree
     vector<int>                                  _triStatus; // from triId to active status
     vector<int>                                  _remValence;//from vertex Id to # active tris
-    std::unordered_map<int,vector<int>>          _adjTris;//from vertexId to adjTris
+    vector<int>                                  _liveTris;//from vertex Id to # ready tris
     vector<int>                                  _cacheStamp;//from vertexId to cacheStamp
+    int                                          _remTris;// # active tris not emitted
+    std::priority_queue<int,vector<int>,std::greater<int>> _readyTris;// may hold emitted tris
 
-    DagMap                                       _occMap;
-    set<int>                                     _actiTris;
+    const DagMap                                *_occMap;// of the cluster in init
     vector<int>                                  _indicesOut;
     deque<int>                                   _startTailList;
     int                                          next;
@@ -29,7 +41,11 @@ class DagFanVCache
 private:
     // when triId is put to outIndice
     int firstChoose();
-    void updateInDeg(int triId);
+    void updateInDeg(int triId,const vector<int>& indices);
+    void setReady(int triId,const vector<int>& indices);
+    void emitTri(int triId,const vector<int>& indices);
+    // lowest ready triId, -1 if none
+    int minReadyTri();
     bool checkFinish();
     void fanTop(int vId,const vector<int>& indices);
     bool checkTri(int triId);
@@ -38,10 +54,8 @@ private:
     int chooseVert(const vector<int>& indices);
     int numActiTris(int vId);
 public:
-    DagFanVCache(int numVerts,int numTris,int cacheSize);
-    // this indices must be corresponding to the triId in occMap
-    //model->getIndices();
-    void init(const DagMap& occMap,const vector<int>& indices);
+    DagFanVCache(const VertexTriAdjacency* adjTris,int numTris,int cacheSize);
+    void init(const DagMap& occMap);
     vector<int> sort(const vector<int>& indices);
     vector<int> getTriOrder() const;
 };
@@ -50,6 +64,16 @@ inline bool DagFanVCache::checkTri(int triId)
     return _triStatus.at(triId) == 1 && _inDegrees[triId] == 0;
 }
 
+inline bool DagFanVCache::checkFinish()
+{
+    return _remTris == 0;
+}
+
+inline int DagFanVCache::numActiTris(int vId)
+{
+    return _liveTris[vId];
+}
+
 inline int DagFanVCache::cf(int p, int c, int v)
 {
     return (((p-c+2*v) > _cacheSize) ? (0) : (p-c));
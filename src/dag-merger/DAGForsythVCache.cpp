@@ -0,0 +1,164 @@
+#include "DAGForsythVCache.h"
+#include "dag-lib/Log.h"
+#include <cmath>
+#include <algorithm>
+
+// scoring of "Linear-Speed Vertex Cache Optimisation", Tom Forsyth
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRI_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+DagForsythVCache::DagForsythVCache(const VertexTriAdjacency* adjTris,int numTris,int cacheSize)
+    :_adjTris(adjTris)
+    ,_numTris(numTris)
+    ,_numVerts(adjTris->getNumberOfVertices())
+    ,_cacheSize(std::max(3,cacheSize))
+    ,_remTris(0)
+    ,_occMap(0)
+{
+    // the vertices of the last triangle score the same whatever their order
+    _posScores.resize(_cacheSize);
+    for(int i=0;i<_cacheSize;i++){
+        if(i < 3)
+            _posScores[i] = LAST_TRI_SCORE;
+        else
+            _posScores[i] = std::pow(1.0f - (float)(i-3)/(_cacheSize-3),CACHE_DECAY_POWER);
+    }
+    // fewer active tris left around a vertex score higher
+    _valenceScores.resize(MAX_VALENCE_SCORE,0.0f);
+    for(int i=1;i<MAX_VALENCE_SCORE;i++)
+        _valenceScores[i] = VALENCE_BOOST_SCALE*std::pow((float)i,-VALENCE_BOOST_POWER);
+}
+
+// only the per cluster state is reset, the adjacency is shared
+void DagForsythVCache::init(const DagMap& occMap)
+{
+    _occMap = &occMap;
+
+    //only set the active tri as available
+    _inDegrees.assign(_numTris,0);
+    _triStatus.assign(_numTris,0);
+    for(auto it = occMap.cbegin();it != occMap.cend();it++){
+        _triStatus[it->first] = 1;
+        for(auto innerIt = it->second.cbegin();innerIt != it->second.cend();innerIt++){
+            _triStatus[innerIt->first] = 1;
+            _inDegrees[innerIt->first] ++;
+        }
+    }
+    _remTris = 0;
+    for(auto status : _triStatus)
+        _remTris += status;
+
+    // valences are counted in sort, they need the indices
+    _remValence.assign(_numVerts,0);
+    _cachePos.assign(_numVerts,-1);
+    _cache.clear();
+    _readyTris = std::priority_queue<int,vector<int>,std::greater<int>>();
+
+    _indicesOut.clear();
+    _indicesOut.reserve(_numTris*3);
+    _triOrderOut.clear();
+    _triOrderOut.reserve(_numTris);
+}
+
+void DagForsythVCache::updateInDeg(int id)
+{
+    auto occIt = _occMap->find(id);
+    if(occIt != _occMap->end()){
+        for(auto it = occIt->second.cbegin();it!= occIt->second.cend();it++){
+            _inDegrees[it->first] --;
+            if(_inDegrees[it->first] < 0){
+                gLogError<<"inDegree Error!";
+            }
+            else if(checkTri(it->first))
+                _readyTris.push(it->first);
+        }
+    }
+}
+
+void DagForsythVCache::emitTri(int triId,const vector<int>& indices)
+{
+    _triOrderOut.push_back(triId);
+    _triStatus[triId] = 0;
+    _remTris--;
+    for(int j=0;j<3;j++){
+        auto id = indices[triId*3+j];
+        _indicesOut.push_back(id);
+        --_remValence[id];
+    }
+    updateInDeg(triId);
+    updateCache(triId,indices);
+}
+
+void DagForsythVCache::updateCache(int triId,const vector<int>& indices)
+{
+    // the vertices of triId move to the front, the rest keeps its order
+    vector<int> cache;
+    cache.reserve(_cacheSize+3);
+    for(int j=0;j<3;j++){
+        auto id = indices[triId*3+j];
+        if(std::find(cache.begin(),cache.end(),id) == cache.end())
+            cache.push_back(id);
+    }
+    auto triEnd = cache.size();
+    for(auto id : _cache){
+        if(std::find(cache.begin(),cache.begin()+triEnd,id) == cache.begin()+triEnd)
+            cache.push_back(id);
+    }
+    for(int i=0;i<(int)cache.size();i++)
+        _cachePos[cache[i]] = i < _cacheSize ? i : -1;
+    if((int)cache.size() > _cacheSize)
+        cache.resize(_cacheSize);
+    _cache.swap(cache);
+}
+
+int DagForsythVCache::chooseTri(const vector<int>& indices)
+{
+    int bestTri = -1;
+    float bestScore = -1.0f;
+    for(auto vId : _cache){
+        for(auto p = _adjTris->trisBegin(vId);p != _adjTris->trisEnd(vId);p++){
+            if(!checkTri(*p))
+                continue;
+            float score = triScore(*p,indices);
+            if(score > bestScore){
+                bestScore = score;
+                bestTri = *p;
+            }
+        }
+    }
+    if(bestTri != -1)
+        return bestTri;
+
+    // emitted tris are dropped when they reach the top
+    while(!_readyTris.empty() && !checkTri(_readyTris.top()))
+        _readyTris.pop();
+    return _readyTris.empty() ? -1 : _readyTris.top();
+}
+
+vector<int> DagForsythVCache::sort(const vector<int>& indices)
+{
+    for(int triId=0;triId<_numTris;triId++){
+        if(_triStatus[triId] == 0)
+            continue;
+        for(int j=0;j<3;j++)
+            _remValence[indices[triId*3+j]]++;
+        if(checkTri(triId))
+            _readyTris.push(triId);
+    }
+    while(_remTris > 0){
+        int triId = chooseTri(indices);
+        if(triId == -1){
+            gLogError<<"no ready triangle, "<<_remTris<<" triangles are in a cycle";
+            break;
+        }
+        emitTri(triId,indices);
+    }
+    return _indicesOut;
+}
+
+vector<int> DagForsythVCache::getTriOrder() const
+{
+    return _triOrderOut;
+}
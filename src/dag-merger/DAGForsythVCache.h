@@ -0,0 +1,78 @@
+#ifndef DAGFORSYTHVCACHE_H
+#define DAGFORSYTHVCACHE_H
+
+#include "DAGVCacheOrder.h"
+#include <queue>
+#include <functional>
+
+/*
+ * Vertex cache order of the triangles of a cluster by vertex scores, LRU cache model
+ *
+ * notes: Forsyth's linear speed optimizer restricted to ready triangles. A
+ *        vertex scores by its position in the simulated LRU cache and by how
+ *        few active triangles still use it, a triangle by the sum of its
+ *        vertices. The best ready triangle around the cached vertices is
+ *        emitted next, if there is none the lowest ready triangle.
+ */
+class DagForsythVCache : public DagVCacheOrder
+{
+    static const int                             MAX_VALENCE_SCORE = 64;// valence scores kept in a table
+
+    const VertexTriAdjacency                    *_adjTris;//from vertexId to adjTris, shared
+    int                                          _numTris;
+    int                                          _numVerts;
+    int                                          _cacheSize;
+
+    vector<float>                                _posScores;// from cache position to score
+    vector<float>                                _valenceScores;// from # active tris to score
+
+    vector<int>                                  _inDegrees;// from triId to indegree
+    vector<int>                                  _triStatus; // from triId to active status
+    vector<int>                                  _remValence;//from vertex Id to # active tris
+    vector<int>                                  _cachePos;//from vertex Id to LRU position, -1 if not cached
+    vector<int>                                  _cache;// vertex Ids, most recent first
+    int                                          _remTris;// # active tris not emitted
+    std::priority_queue<int,vector<int>,std::greater<int>> _readyTris;// may hold emitted tris
+
+    const DagMap                                *_occMap;// of the cluster in init
+    vector<int>                                  _indicesOut;
+    vector<int>                                  _triOrderOut;
+
+private:
+    bool checkTri(int triId) const;
+    float vertScore(int vId) const;
+    float triScore(int triId,const vector<int>& indices) const;
+    void updateInDeg(int triId);
+    void emitTri(int triId,const vector<int>& indices);
+    void updateCache(int triId,const vector<int>& indices);
+    // best ready tri around the cache, else lowest ready tri, -1 if none
+    int chooseTri(const vector<int>& indices);
+public:
+    DagForsythVCache(const VertexTriAdjacency* adjTris,int numTris,int cacheSize);
+    void init(const DagMap& occMap);
+    vector<int> sort(const vector<int>& indices);
+    vector<int> getTriOrder() const;
+};
+
+inline bool DagForsythVCache::checkTri(int triId) const
+{
+    return _triStatus[triId] == 1 && _inDegrees[triId] == 0;
+}
+
+inline float DagForsythVCache::vertScore(int vId) const
+{
+    int valence = _remValence[vId];
+    if(valence == 0)
+        return -1.0f;
+    float score = _cachePos[vId] < 0 ? 0.0f : _posScores[_cachePos[vId]];
+    if(valence < MAX_VALENCE_SCORE)
+        return score + _valenceScores[valence];
+    return score + _valenceScores[MAX_VALENCE_SCORE-1];
+}
+
+inline float DagForsythVCache::triScore(int triId,const vector<int>& indices) const
+{
+    return vertScore(indices[triId*3]) + vertScore(indices[triId*3+1]) + vertScore(indices[triId*3+2]);
+}
+
+#endif // DAGFORSYTHVCACHE_H
@@ -9,6 +9,11 @@
 #include <time.h>
 #include "dag-lib/SampledTriangle.h"
 #include "dag-lib/DAGCenter.h"
+#include "dag-lib/ViewGrid.h"
+#include "dag-lib/TaskScheduler.h"
+#include <atomic>
+#include <mutex>
+#include <algorithm>
 
 DagMaker::DagMaker(ModelBase* pModel, DAGCenter* pDagCenter)
     :_pModel(pModel)
@@ -16,6 +21,7 @@ DagMaker::DagMaker(ModelBase* pModel, DAGCenter* pDagCenter)
     ,_pTriViewModel(0)
     ,_pDagCenter(pDagCenter)
     ,_pOccluder(0)
+    ,_lazyRelation(false)
 {
 
 }
@@ -32,8 +38,9 @@ DagMaker::~DagMaker()
         delete _pOccluder;
 }
 
-void DagMaker::init(int triSub,int pointSubLevel, double Parameter1)
+void DagMaker::init(int triSub,int pointSubLevel, double Parameter1, bool lazyRelation)
 {
+    _lazyRelation = lazyRelation;
     // Initiate View Model
     auto radius = _pModel->getRadius();
     auto center = _pModel->getCenter3d();
@@ -54,45 +61,225 @@ void DagMaker::init(int triSub,int pointSubLevel, double Parameter1)
                 _pModel->getRadius()*3.0, Parameter1);
 }
 
+// front triangles per row block task
+static const int ROW_BLOCK = 256;
+// facets per thread folded at a time by genTriDags
+static const int STREAM_WINDOW = 4;
+
+// state of one point view, shared by its row block tasks
+struct ViewJob{
+    ViewGrid                        grid;
+    VEPlaneCache                    planes;
+    vector<vector<uint64_t>>        blockEdges; // packed edges found by each row block
+    vector<uint64_t>                viewEdges;  // all blocks, sorted into the view dag
+    std::atomic<int>                nBlocksLeft;
+
+    ViewJob(const vector<Triangle> &triangles):grid(triangles),nBlocksLeft(0){}
+};
+
 // compute partial order graphs associated with each view
-void DagMaker::genDags()
+bool DagMaker::genDags(int numThreads)
 {
     gLogInfo << "Generating DAGs";
-    int numthreads = omp_get_max_threads();
+    // leave one core by default
+    if (numThreads <= 0)
+        numThreads = std::max(1, omp_get_max_threads() - 1);
+    gLogInfo << "threads " << numThreads;
 
     int nPointDags = _pPointViewModel->getNumberOfNodes();
-    int nTris = _pModel->getNumberOfTriangles();
 
-    _pOccluder->preprocess(numthreads);
-    _pOccluder->preprocessRelation(numthreads);
+    _pOccluder->preprocess(numThreads);
+    if (!_pOccluder->preprocessRelation(numThreads, _lazyRelation))
+        return false;
 
-    omp_set_dynamic(0);     // Explicitly disable dynamic teams
-    omp_set_num_threads(numthreads -1);
-#pragma omp parallel for
-    for(auto k=0;k<nPointDags;++k){
-        _pOccluder->preprocessVEMap(k);
-        DAG* dag = _pDagCenter->getPointDag(k);
-        for (auto i = 0; i < nTris; ++i) {
-            if(_pOccluder->isFaceAway(k,i))
-                continue;
-            for (auto j = i+1; j < nTris; ++j) {
-                if(_pOccluder->isFaceAway(k,j))
-                    continue;
+    vector<int> pointIds(nPointDags);
+    for (auto k = 0; k < nPointDags; ++k)
+        pointIds[k] = k;
+    _genPointDags(pointIds, numThreads);
+    gLogInfo << "Successfully generated point DAGs";
+    return true;
+}
+
+// point dags of pointIds, the occluder is preprocessed
+void DagMaker::_genPointDags(const vector<int> &pointIds, int numThreads)
+{
+    const auto &triangles = _pModel->getTriangles();
+    auto center = _pModel->getCenter3d();
+
+    // views differ a lot in front triangles and candidate pairs, so a view is
+    // split into row blocks and idle workers steal blocks of busy views
+    TaskScheduler scheduler(numThreads);
+    vector<vector<int>> candidates(numThreads);
+    vector<vector<int>> relations(numThreads);
+    vector<DagOccluder::BatchScratch> scratches(numThreads);
+
+    // view jobs are recycled, at most a few per worker are alive
+    std::mutex poolLock;
+    vector<ViewJob*> pool;
+    vector<ViewJob*> allJobs;
+    auto acquireJob = [&]() {
+        std::lock_guard<std::mutex> guard(poolLock);
+        if (pool.empty()) {
+            allJobs.push_back(new ViewJob(triangles));
+            return allJobs.back();
+        }
+        ViewJob *job = pool.back();
+        pool.pop_back();
+        return job;
+    };
+    auto releaseJob = [&](ViewJob *job) {
+        std::lock_guard<std::mutex> guard(poolLock);
+        pool.push_back(job);
+    };
+
+    auto rowBlock = [&](int k, ViewJob *job, int block, int workerId) {
+        const int *frontTris = _pOccluder->getFrontTris(k);
+        int nFront = _pOccluder->getNumberOfFrontTris(k);
+        auto &cand = candidates[workerId];
+        auto &rel = relations[workerId];
+        auto &edges = job->blockEdges[block];
+        edges.clear();
 
-                auto r = _pOccluder->occludeSimple(k,i,j,false);
+        // only pairs with overlapping projections reach the exact test.
+        // front tris and candidates are sorted by id, so relation lookups
+        // walk the relation table tile by tile as the full pair walk did
+        int fEnd = std::min(nFront, (block + 1) * ROW_BLOCK);
+        for (auto f = block * ROW_BLOCK; f < fEnd; ++f) {
+            auto i = frontTris[f];
+            job->grid.getCandidates(i, cand);
+            _pOccluder->occludeSimple(job->planes, i, cand, rel, scratches[workerId]);
+            for (size_t c = 0; c < cand.size(); ++c) {
+                auto j = cand[c];
+                auto r = rel[c];
                 if ( r == 0 )
                     continue;
                 else if (r == 1)
-                    dag->addEdge( i, j);
+                    edges.push_back(DagCSR::packEdge(i, j));
                 else if (r == 2)
-                    dag->addEdge( j, i);
+                    edges.push_back(DagCSR::packEdge(j, i));
                 else if(r == 3 )
                     gLogError<<"Self cycle edge! ";
             }
         }
-        _pOccluder->clearVEMap(k);
+
+        // the last block of a view sorts all edges into its compact dag
+        if (--job->nBlocksLeft == 0) {
+            auto &viewEdges = job->viewEdges;
+            viewEdges.clear();
+            for (const auto &blockEdges : job->blockEdges)
+                viewEdges.insert(viewEdges.end(), blockEdges.begin(), blockEdges.end());
+            _pDagCenter->getPointDag(k)->setEdges(viewEdges);
+            releaseJob(job);
+        }
+    };
+
+    auto viewTask = [&](int k, int workerId) {
+        ViewJob *job = acquireJob();
+        _pOccluder->preprocessVEMap(k, job->planes);
+        auto& point = static_cast<const ViewNodePoint*>(_pPointViewModel->getNode(k))->getPoint();
+
+        // back faces never take part
+        const int *frontTris = _pOccluder->getFrontTris(k);
+        int nFront = _pOccluder->getNumberOfFrontTris(k);
+        job->grid.build(point, center, frontTris, nFront);
+
+        int nBlocks = (nFront + ROW_BLOCK - 1) / ROW_BLOCK;
+        if (nBlocks == 0) {
+            releaseJob(job);
+            return;
+        }
+        job->blockEdges.resize(nBlocks);
+        job->nBlocksLeft = nBlocks;
+        // pushed in reverse so this worker continues with the first block
+        for (int b = nBlocks - 1; b >= 0; --b)
+            scheduler.push([&rowBlock, k, job, b](int w) { rowBlock(k, job, b, w); }, workerId);
+    };
+
+    for (size_t n = 0; n < pointIds.size(); ++n) {
+        int k = pointIds[n];
+        scheduler.push([&viewTask, k](int w) { viewTask(k, w); }, n % numThreads);
     }
-    gLogInfo << "Successfully generated point DAGs";
+    scheduler.run();
+
+    for (auto job : allJobs)
+        delete job;
+}
+
+// facets of the triangle view model each fold in the point views sampled on them
+std::map<int,std::set<int>> DagMaker::_getPreClusteringMap(int innerSub) const
+{
+    auto radius = 3.0 * _pModel->getRadius();
+    auto vertices = static_cast<const SFViewFacet*>(_pTriViewModel)->sfGetVertices();
+    auto faces = static_cast<const SFViewFacet*>(_pTriViewModel)->sfGetTriangles();
+    SampledTriangle sampledTri(innerSub,vertices,faces,
+                                     radius,_pModel->getCenter3d());
+    return sampledTri.getMap();
+}
+
+// windows of facets at a time: their missing point dags are generated, folded
+// into the facet dags and freed once no later facet needs them
+bool DagMaker::genTriDags(int innerSub, int numThreads)
+{
+    gLogInfo << "Generating facet DAGs";
+    if (numThreads <= 0)
+        numThreads = std::max(1, omp_get_max_threads() - 1);
+    gLogInfo << "threads " << numThreads;
+
+    _pOccluder->preprocess(numThreads);
+    if (!_pOccluder->preprocessRelation(numThreads, _lazyRelation))
+        return false;
+
+    auto preClusteringMap = _getPreClusteringMap(innerSub);
+    int nDags = _pTriViewModel->getNumberOfNodes();
+    int nPointDags = _pPointViewModel->getNumberOfNodes();
+
+    // facets left to fold each point dag
+    vector<int> refCounts(nPointDags, 0);
+    for (const auto &facet : preClusteringMap)
+        for (auto pointId : facet.second)
+            refCounts[pointId]++;
+    // points no facet samples are never generated
+    for (auto pointId = 0; pointId < nPointDags; ++pointId)
+        if (refCounts[pointId] == 0)
+            _pDagCenter->cleanPointDag(pointId);
+
+    vector<char> generated(nPointDags, 0);
+    int window = STREAM_WINDOW * numThreads;
+    int nResident = 0;
+    int maxResident = 0;
+    for (int first = 0; first < nDags; first += window) {
+        int last = std::min(nDags, first + window);
+
+        vector<int> pointIds;
+        for (int triId = first; triId < last; triId++)
+            for (auto pointId : preClusteringMap.at(triId))
+                if (!generated[pointId]) {
+                    generated[pointId] = 1;
+                    pointIds.push_back(pointId);
+                }
+        _genPointDags(pointIds, numThreads);
+        nResident += (int)pointIds.size();
+        maxResident = std::max(maxResident, nResident);
+
+        // facet dags are independent, point dags are only read
+#pragma omp parallel for schedule(dynamic,1) num_threads(numThreads)
+        for (int triId = first; triId < last; triId++) {
+            auto triDag = _pDagCenter->getDag2(triId);
+            for (auto pointId : preClusteringMap.at(triId))
+                triDag->updateDAG(*_pDagCenter->getPointDag(pointId));
+            triDag->freeze();
+        }
+
+        for (int triId = first; triId < last; triId++)
+            for (auto pointId : preClusteringMap.at(triId))
+                if (--refCounts[pointId] == 0) {
+                    _pDagCenter->cleanPointDag(pointId);
+                    nResident--;
+                }
+    }
+    gLogInfo << "Successfully generated facet DAGs, at most " << maxResident
+             << " of " << nPointDags << " point DAGs resident";
+    return true;
 }
 
 void DagMaker::savePointDags(string pointDir)
@@ -109,12 +296,7 @@ void DagMaker::savePointDags(string pointDir)
 void DagMaker::preClustering(int innerSub)
 {
     gLogInfo<<"pre clustering";
-    auto radius = 3.0 * _pModel->getRadius();
-    auto vertices = static_cast<const SFViewFacet*>(_pTriViewModel)->sfGetVertices();
-    auto faces = static_cast<const SFViewFacet*>(_pTriViewModel)->sfGetTriangles();
-    SampledTriangle sampledTri(innerSub,vertices,faces,
-                                     radius,_pModel->getCenter3d());
-    auto preClusteringMap = sampledTri.getMap();
+    auto preClusteringMap = _getPreClusteringMap(innerSub);
     int nDags = _pTriViewModel->getNumberOfNodes();
     for(int triId=0;triId<nDags;triId++){
         auto triDag = _pDagCenter->getDag2(triId);
@@ -123,6 +305,8 @@ void DagMaker::preClustering(int innerSub)
             auto pointDag = _pDagCenter->getPointDag(pointId);
             triDag->updateDAG(*pointDag);
         }
+        // triangle dags are only read and copied from now on
+        triDag->freeze();
     }
     _pDagCenter->cleanPointDags();
     gLogInfo<<"finish preclustering";
@@ -19,17 +19,25 @@ private:
     SFViewBase         *_pTriViewModel;
     DAGCenter           *_pDagCenter;
     DagOccluder         *_pOccluder;
+    bool                 _lazyRelation;
+
+    void _genPointDags(const vector<int> &pointIds, int numThreads);
+    std::map<int,std::set<int>> _getPreClusteringMap(int innerSub) const;
 
 public:
     DagMaker(ModelBase* pModel, DAGCenter* pDagCenter);
     ~DagMaker();
 
-    void init(int triSub,int pointSubLevel, double Parameter1 = 1000.0f);
+    // lazyRelation computes triangle pair relations only where views need them
+    void init(int triSub,int pointSubLevel, double Parameter1 = 1000.0f, bool lazyRelation = false);
 
-    void genDags();
+    // numThreads <= 0 takes all cores but one, false if the occluder can't be set up
+    bool genDags(int numThreads = 0);
 
     // preclustering
     void preClustering(int innerSub);
+    // genDags and preClustering without keeping all point dags in memory
+    bool genTriDags(int innerSub, int numThreads = 0);
     //to delete
     void savePointDags(string pointDir);
 };
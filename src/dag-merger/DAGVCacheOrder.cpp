@@ -0,0 +1,44 @@
+#include "DAGVCacheOrder.h"
+#include "DAGFanVCache.h"
+#include "DAGForsythVCache.h"
+
+VertexTriAdjacency::VertexTriAdjacency(int numVerts,const vector<int>& indices)
+{
+    int numTris = (int)indices.size()/3;
+    _offsets.assign(numVerts+1,0);
+    for(int i=0;i<numTris*3;i++)
+        _offsets[indices[i]+1]++;
+    for(int v=0;v<numVerts;v++)
+        _offsets[v+1] += _offsets[v];
+
+    // triangles are visited in id order, so each row is sorted
+    _tris.resize(numTris*3);
+    vector<int> fill(_offsets.begin(),_offsets.end()-1);
+    for(int i=0;i<numTris;i++){
+        for(int j=0;j<3;j++)
+            _tris[fill[indices[i*3+j]]++] = i;
+    }
+}
+
+DagVCacheOrder* DagVCacheOrder::create(Method method,const VertexTriAdjacency* adjTris,int numTris,int cacheSize)
+{
+    if(method == FORSYTH)
+        return new DagForsythVCache(adjTris,numTris,cacheSize);
+    return new DagFanVCache(adjTris,numTris,cacheSize);
+}
+
+bool DagVCacheOrder::parseMethod(const std::string& name,Method& method)
+{
+    if(name == "fan")
+        method = FAN;
+    else if(name == "forsyth")
+        method = FORSYTH;
+    else
+        return false;
+    return true;
+}
+
+const char* DagVCacheOrder::methodName(Method method)
+{
+    return method == FORSYTH ? "forsyth" : "fan";
+}
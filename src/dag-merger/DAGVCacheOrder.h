@@ -0,0 +1,75 @@
+#ifndef DAGVCACHEORDER_H
+#define DAGVCACHEORDER_H
+
+#include "dag-lib/DagGraph.h"
+#include <string>
+
+/*
+ * Triangles around each vertex of a mesh
+ *
+ * notes: CSR rows list the triangles in id order. It only depends on the
+ *        mesh, so it is built once and shared read only by the vertex cache
+ *        orders of every thread
+ */
+class VertexTriAdjacency
+{
+    vector<int>                                  _offsets;// from vertexId to first entry, numVerts + 1
+    vector<int>                                  _tris;
+
+public:
+    VertexTriAdjacency(int numVerts,const vector<int>& indices);
+
+    int getNumberOfVertices() const;
+    int valence(int vId) const;
+    const int* trisBegin(int vId) const;
+    const int* trisEnd(int vId) const;
+};
+
+/*
+ * Vertex cache order of the triangles of a cluster under its DAG
+ *
+ * notes: a triangle is emitted only after all triangles with an edge to it.
+ *        init resets the state of a cluster, so one instance per thread can
+ *        order any number of clusters
+ */
+class DagVCacheOrder
+{
+public:
+    enum Method { FAN, FORSYTH };
+
+    virtual ~DagVCacheOrder() {}
+
+    // occMap is kept until the next init, it must live until sort is done
+    virtual void init(const DagMap& occMap) = 0;
+    // this indices must be corresponding to the triId in occMap and adjTris
+    //model->getIndices();
+    virtual vector<int> sort(const vector<int>& indices) = 0;
+    virtual vector<int> getTriOrder() const = 0;
+
+    static DagVCacheOrder* create(Method method,const VertexTriAdjacency* adjTris,int numTris,int cacheSize);
+    // "fan" or "forsyth", false if name is neither
+    static bool parseMethod(const std::string& name,Method& method);
+    static const char* methodName(Method method);
+};
+
+inline int VertexTriAdjacency::getNumberOfVertices() const
+{
+    return (int)_offsets.size() - 1;
+}
+
+inline int VertexTriAdjacency::valence(int vId) const
+{
+    return _offsets[vId+1] - _offsets[vId];
+}
+
+inline const int* VertexTriAdjacency::trisBegin(int vId) const
+{
+    return _tris.data() + _offsets[vId];
+}
+
+inline const int* VertexTriAdjacency::trisEnd(int vId) const
+{
+    return _tris.data() + _offsets[vId+1];
+}
+
+#endif // DAGVCACHEORDER_H
@@ -5,15 +5,25 @@
 TARGET = dag-merger
 TEMPLATE = app
 
+msvc {
+  QMAKE_CXXFLAGS += -openmp
+}
+
 SOURCES += \
     main.cpp \ 
     DAGMaker.cpp \
     BufferMaker.cpp \
-    DAGFanVCache.cpp
+    Checkpoint.cpp \
+    DAGFanVCache.cpp \
+    DAGForsythVCache.cpp \
+    DAGVCacheOrder.cpp
 
 HEADERS += \
     DAGMaker.h \
     BufferMaker.h \
-    DAGFanVCache.h
+    Checkpoint.h \
+    DAGFanVCache.h \
+    DAGForsythVCache.h \
+    DAGVCacheOrder.h
 
 
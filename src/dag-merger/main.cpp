@@ -9,6 +9,10 @@
 #include "time.h"
 #include "DAGMaker.h"
 #include "dag-lib/DAGCenter.h"
+#include "Checkpoint.h"
+#include "omp.h"
+#include <algorithm>
+#include <sstream>
 
 int main(int argc, char *argv[])
 {
@@ -30,8 +34,18 @@ int main(int argc, char *argv[])
             ("cacheRoot,c", po::value< std::string >()->default_value("./cache"),"Cache root path. default ./cache")
             ("EpsilonPara,e", po::value< double >()->default_value(1000.0), "Epsilon over paramter. default 3000.0")
             ("priorityMetric,p",po::value< int >()->default_value(1),"Defualt 1. 1 for max share Edges")
-            ("iteration,i",po::value< int >()->default_value(10),"Defualt 10 for iteration")
+            ("iteration,i",po::value< int >()->default_value(10),"Defualt 10 for maximum relaxation rounds")
+            ("relaxTime",po::value< double >()->default_value(0.0),"Time budget of relaxation in seconds. Default 0 for no limit")
+            ("seed",po::value< unsigned >()->default_value(0),"Random seed of relaxation. Default 0")
             ("innerSub,l",po::value< int >()->default_value(-1),"Defualt inner sub division level -1")
+            ("threads,t",po::value< int >()->default_value(0),"Number of threads. Default 0 for all cores but one")
+            ("parallelMerge",po::bool_switch()->default_value(false),"Merge independent cluster pairs in parallel")
+            ("lazyRelation",po::bool_switch()->default_value(false),"Compute triangle pair relations on first use instead of for all pairs")
+            ("stream",po::bool_switch()->default_value(false),"Fold point DAGs into facet DAGs as they are generated to bound memory")
+            ("resume",po::bool_switch()->default_value(false),"Skip phases finished by an earlier run with the same inputs")
+            ("maxResidentDags",po::value< int >()->default_value(0),"Page facet DAGs from the cache, at most this many held by the DAG center. Cluster DAGs are not paged. Default 0 keeps all")
+            ("vcache",po::value< std::string >()->default_value("fan"),"Vertex cache optimizer, fan (FIFO model) or forsyth (LRU model). Default fan")
+            ("cacheSize",po::value< int >()->default_value(20),"Vertex cache size the buffers are optimized for. Default 20")
         ;
 
         po::options_description cmd_desc("Command arguments");
@@ -64,6 +78,23 @@ int main(int argc, char *argv[])
 
     auto metric = vm["priorityMetric"].as<int>();
     auto iterTimes = vm["iteration"].as<int>();
+    auto numThreads = vm["threads"].as<int>();
+    if (numThreads <= 0)
+        numThreads = std::max(1, omp_get_max_threads() - 1);
+    auto parallelMerge = vm["parallelMerge"].as<bool>();
+    auto stream = vm["stream"].as<bool>();
+    auto lazyRelation = vm["lazyRelation"].as<bool>();
+    auto relaxTime = vm["relaxTime"].as<double>();
+    auto seed = vm["seed"].as<unsigned>();
+    auto resume = vm["resume"].as<bool>();
+    auto maxResidentDags = vm["maxResidentDags"].as<int>();
+    auto cacheSize = vm["cacheSize"].as<int>();
+    DagVCacheOrder::Method vCacheMethod;
+    if (!DagVCacheOrder::parseMethod(vm["vcache"].as<std::string>(), vCacheMethod) || cacheSize <= 0) {
+        gLogError << "unknown vertex cache optimizer " << vm["vcache"].as<std::string>()
+                  << " or cache size " << cacheSize;
+        return 1;
+    }
 
     double nearScale = 3.0;
     std::string cacheDir;
@@ -78,26 +109,93 @@ int main(int argc, char *argv[])
     // init DagCenter
     DAGCenter* pDagCenter = new DAGCenter(numTris);
 
-    // generate Dags
-    gLogInfo<<"sublevel "<<pointSub;
-    DagMaker maker(pModel, pDagCenter);
-    maker.init(sub, pointSub, Parameter1);
-    maker.genDags();
-    maker.preClustering(innerSub);
+    // keys of the inputs of each phase, the thread count doesn't change results
+    Checkpoint checkpoint(cacheDir);
+    std::ostringstream key;
+    key << Checkpoint::fileKey(model) << " tris " << numTris << " sub " << sub
+        << " innerSub " << innerSub << " eps " << Parameter1;
+    std::string dagsKey = key.str();
+    key << " metric " << metric << " parallelMerge " << parallelMerge;
+    std::string mergeKey = key.str();
+    key << " iteration " << iterTimes << " relaxTime " << relaxTime << " seed " << seed;
+    std::string relaxKey = key.str();
+    key << " vcache " << DagVCacheOrder::methodName(vCacheMethod) << " cacheSize " << cacheSize;
+    std::string vCacheKey = key.str();
+    std::string mergeFile = cacheDir + "/merge_clusters.txt";
+    std::string relaxFile = cacheDir + "/relax_clusters.txt";
+
+    if (resume && checkpoint.isDone("vcache", vCacheKey)) {
+        gLogInfo<<"resume: all phases are done in "<<cacheDir;
+        return 0;
+    }
+
+    // generate Dags, dags.bin can only be paged if it holds the DAGs of dagsKey
+    bool dagsSaved = false;
+    if (resume && checkpoint.isDone("dags", dagsKey) && pDagCenter->load(cacheDir)) {
+        gLogInfo<<"resume: facet DAGs loaded";
+        dagsSaved = true;
+    }
+    else {
+        gLogInfo<<"sublevel "<<pointSub;
+        DagMaker maker(pModel, pDagCenter);
+        maker.init(sub, pointSub, Parameter1, lazyRelation);
+        // the occlusion tests read the relation table, no DAG is right without it
+        bool generated = stream ? maker.genTriDags(innerSub, numThreads) : maker.genDags(numThreads);
+        if (!generated) {
+            gLogError<<"Failed to generate DAGs";
+            return 1;
+        }
+        if (!stream)
+            maker.preClustering(innerSub);
+        // a phase is only done once its results are on disk
+        dagsSaved = !cacheDir.empty() && pDagCenter->save(cacheDir);
+        if (dagsSaved)
+            checkpoint.setDone("dags", dagsKey);
+        else if (!cacheDir.empty())
+            gLogWarn<<"facet DAGs are not saved, they can't be resumed";
+    }
+    if (maxResidentDags > 0) {
+        // a dags.bin of an earlier run may have other DAGs of the same model
+        if (!dagsSaved)
+            gLogWarn<<"The DAG cache is not saved, keep all DAGs in memory";
+        else if (!pDagCenter->page(cacheDir, maxResidentDags))
+            gLogWarn<<"Paging failed, keep all DAGs in memory";
+    }
 
     gLogInfo<<"prepare merging";
     // merge Dags
     BufferMaker merger(pModel, pDagCenter);
     merger.init(sub, metric);
-    merger.merge();
+    if (resume && checkpoint.isDone("merge", mergeKey) && merger.loadClusters(mergeFile)) {
+        gLogInfo<<"resume: merged clusters loaded";
+    }
+    else {
+        merger.merge(parallelMerge, numThreads);
+        if (!cacheDir.empty() && merger.saveClusters(mergeFile))
+            checkpoint.setDone("merge", mergeKey);
+    }
+
+    gLogInfo<<"peak memory after merging "<<getPeakMemoryMB()<<" MB";
+
     int oldNClusters = merger.getNClusters();
-    for( int i=0;i<iterTimes;i++){
-        merger.updateClusters();
+    if (resume && checkpoint.isDone("relax", relaxKey) && merger.loadClusters(relaxFile)) {
+        gLogInfo<<"resume: relaxed clusters loaded";
+    }
+    else {
+        merger.relaxClusters(iterTimes, relaxTime, seed, numThreads);
+        if (!cacheDir.empty() && merger.saveClusters(relaxFile))
+            checkpoint.setDone("relax", relaxKey);
     }
     int nClusters = merger.getNClusters();
     gLogInfo<<"relax cluster from "<< oldNClusters<<" -- " <<nClusters;
-    merger.saveAssign(cacheDir);
-    merger.vCacheOrder(cacheDir);
+    gLogInfo<<"peak memory after relaxing "<<getPeakMemoryMB()<<" MB";
+    bool saved = merger.saveAssign(cacheDir);
+    saved = merger.vCacheOrder(cacheDir, numThreads, vCacheMethod, cacheSize) && saved;
+    if (!saved) {
+        gLogError<<"buffers are not saved";
+        return 1;
+    }
+    checkpoint.setDone("vcache", vCacheKey);
 
     return 0;
 }
@@ -0,0 +1,210 @@
+#include "RasterVerify.h"
+#include "SoftRaster.h"
+#include "dag-lib/Log.h"
+#include <fstream>
+#include <cmath>
+#include <omp.h>
+
+RasterVerify::RasterVerify()
+    :_pModel(0)
+{
+}
+
+RasterVerify::~RasterVerify()
+{
+    if (_pModel)
+        delete _pModel;
+}
+
+bool RasterVerify::init(const string &modelFile, const string &cacheDir, int bufferId)
+{
+    _pModel = new ModelBase(modelFile.c_str(), true);
+
+    // load assignments
+    string fileName = cacheDir + "/assignments.txt";
+    std::ifstream ifs(fileName);
+    if (!ifs.is_open()) {
+        gLogError << "assignment file not found " << fileName;
+        return false;
+    }
+    int id;
+    double theta, phi;
+    while (ifs >> id >> theta >> phi) {
+        _assigns.push_back(id);
+        _assignDirs.push_back(Vector3d(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta)));
+    }
+    if (_assigns.empty() && bufferId < 0) {
+        gLogError << "no views in " << fileName;
+        return false;
+    }
+
+    // load buffers, tri orders give the triangle of each index triple
+    const auto &modelIndices = _pModel->getIndices();
+    vector<int> bufferIds(_assigns);
+    if (bufferId >= 0)
+        bufferIds.assign(1, bufferId);
+    for (auto id : bufferIds) {
+        if (_indices.count(id))
+            continue;
+        fileName = cacheDir + "/Indices_" + to_string(id) + ".txt";
+        ifs.close();
+        ifs.clear();
+        ifs.open(fileName);
+        if (!ifs.is_open()) {
+            gLogError << "indice file not found " << fileName;
+            return false;
+        }
+        auto &indices = _indices[id];
+        int vId;
+        while (ifs >> vId) {
+            if (vId < 0 || vId >= _pModel->getNumberOfVertices()) {
+                gLogError << fileName << " doesn't match the model";
+                return false;
+            }
+            indices.push_back(vId);
+        }
+
+        fileName = cacheDir + "/triOrder_" + to_string(id) + ".txt";
+        ifs.close();
+        ifs.clear();
+        ifs.open(fileName);
+        if (!ifs.is_open()) {
+            gLogError << "tri order file not found " << fileName;
+            return false;
+        }
+        auto &triOrder = _triOrders[id];
+        int triId;
+        while (ifs >> triId) {
+            if (triId < 0 || triId >= _pModel->getNumberOfTriangles()) {
+                gLogError << fileName << " doesn't match the model";
+                return false;
+            }
+            triOrder.push_back(triId);
+        }
+
+        // the buffer is what gets drawn, the tri order only names its triangles
+        if (indices.size() != triOrder.size() * 3) {
+            gLogError << "Indices_" << id << ".txt has " << indices.size() << " indices but triOrder_"
+                      << id << ".txt has " << triOrder.size() << " triangles";
+            return false;
+        }
+        for (size_t k = 0; k < triOrder.size(); ++k) {
+            for (int j = 0; j < 3; ++j) {
+                if (indices[k * 3 + j] != modelIndices[triOrder[k] * 3 + j]) {
+                    gLogError << "Indices_" << id << ".txt and triOrder_" << id
+                              << ".txt disagree at triangle " << k;
+                    return false;
+                }
+            }
+        }
+    }
+    gLogInfo << _assigns.size() << " views, " << _indices.size() << " buffers in " << cacheDir;
+    return true;
+}
+
+// nearest view of assignments, as chooseBuffer2 of dag-viewer
+int RasterVerify::chooseBuffer(const Vector3d &dir) const
+{
+    int best = 0;
+    double bestDot = -2.0;
+    for (int k = 0; k < (int)_assignDirs.size(); ++k) {
+        double dot = dir.Dot(_assignDirs[k]);
+        if (dot > bestDot) {
+            bestDot = dot;
+            best = k;
+        }
+    }
+    return _assigns[best];
+}
+
+int RasterVerify::run(int nViews, int width, int height, double nearScale, double tolerance,
+                      int numThreads, int bufferId)
+{
+    // evenly spread views on a Fibonacci sphere
+    _results.resize(nViews);
+    double golden = PI * (3.0 - sqrt(5.0));
+    for (int k = 0; k < nViews; ++k) {
+        double z = 1.0 - 2.0 * (k + 0.5) / nViews;
+        double r = sqrt(std::max(0.0, 1.0 - z * z));
+        _results[k].viewId = k;
+        _results[k].dir = Vector3d(r * cos(golden * k), r * sin(golden * k), z);
+        _results[k].bufferId = bufferId >= 0 ? bufferId : chooseBuffer(_results[k].dir);
+    }
+
+    auto center = _pModel->getCenter3d();
+    double distance = _pModel->getRadius() * nearScale;
+    int nTris = _pModel->getNumberOfTriangles();
+    vector<SoftRaster> rasters(std::max(1, numThreads), SoftRaster(width, height));
+#pragma omp parallel for schedule(dynamic,1) num_threads(numThreads)
+    for (int k = 0; k < nViews; ++k) {
+        auto &result = _results[k];
+        auto &raster = rasters[omp_get_thread_num()];
+        raster.setCamera(center + result.dir * distance, center);
+
+        raster.clear();
+        for (int triId = 0; triId < nTris; ++triId) {
+            const auto &tri = _pModel->getTriangle(triId);
+            raster.draw(triId, tri._vertices[0], tri._vertices[1], tri._vertices[2], true);
+        }
+        vector<int> reference = raster.getIds();
+
+        raster.clear();
+        const auto &indices = _indices.at(result.bufferId);
+        const auto &triOrder = _triOrders.at(result.bufferId);
+        for (size_t t = 0; t < triOrder.size(); ++t) {
+            raster.draw(triOrder[t], _pModel->getVertexPosition3d(indices[t * 3]),
+                        _pModel->getVertexPosition3d(indices[t * 3 + 1]),
+                        _pModel->getVertexPosition3d(indices[t * 3 + 2]), false);
+        }
+        const auto &ids = raster.getIds();
+
+        result.covered = 0;
+        result.incorrect = 0;
+        for (size_t pix = 0; pix < ids.size(); ++pix) {
+            if (reference[pix] != -1)
+                result.covered++;
+            if (ids[pix] != reference[pix])
+                result.incorrect++;
+        }
+        result.overdraw = result.covered ? (double)raster.getFragments() / result.covered : 0;
+        result.failed = result.incorrect > tolerance * result.covered;
+    }
+
+    int nFailed = 0;
+    double sumIncorrect = 0, sumOverdraw = 0;
+    for (const auto &result : _results) {
+        if (result.failed) {
+            nFailed++;
+            gLogWarn << "view " << result.viewId << " (" << result.dir[0] << " " << result.dir[1] << " "
+                     << result.dir[2] << ") buffer " << result.bufferId << ": "
+                     << result.incorrect << " of " << result.covered << " pixels incorrect";
+        }
+        sumIncorrect += result.covered ? (double)result.incorrect / result.covered : 0;
+        sumOverdraw += result.overdraw;
+    }
+    if (nViews > 0)
+        gLogInfo << nFailed << " of " << nViews << " views failed, mean incorrect "
+                 << sumIncorrect / nViews << ", mean overdraw " << sumOverdraw / nViews;
+    return nFailed;
+}
+
+bool RasterVerify::saveCsv(const string &fileName) const
+{
+    std::ofstream ofs(fileName);
+    if (!ofs.is_open()) {
+        gLogError << "Failed to write " << fileName;
+        return false;
+    }
+    ofs << "view,buffer,x,y,z,covered,incorrect,overdraw,failed" << std::endl;
+    for (const auto &r : _results)
+        ofs << r.viewId << "," << r.bufferId << "," << r.dir[0] << "," << r.dir[1] << "," << r.dir[2] << ","
+            << r.covered << "," << r.incorrect << "," << r.overdraw << "," << (r.failed ? 1 : 0) << std::endl;
+    ofs.close();
+    gLogInfo << "save " << fileName;
+    return true;
+}
+
+const vector<RasterVerify::ViewResult>& RasterVerify::getResults() const
+{
+    return _results;
+}
@@ -0,0 +1,61 @@
+#ifndef RASTERVERIFY_H
+#define RASTERVERIFY_H
+
+#include <string>
+#include <map>
+#include "dag-lib/ModelBase.h"
+
+/*
+ * Check in-depth buffers by rendering them on the CPU
+ *
+ * notes: each sampled view renders the index triples of Indices_<id>.txt in
+ *        order without depth test, as dag-viewer does, and the whole model
+ *        with depth test as reference. triOrder_<id>.txt only names the
+ *        triangle of each triple and has to agree with the indices. Pixels
+ *        that show a different triangle are incorrect.
+ *        Views are sampled evenly on the sphere at nearScale times the model
+ *        radius and use the buffer of the nearest view of assignments.txt.
+ *        Views run in parallel, each thread with its own rasterizer.
+ */
+class RasterVerify
+{
+public:
+    struct ViewResult
+    {
+        int         viewId;
+        int         bufferId;
+        Vector3d    dir; // from the center to the eye
+        int         covered; // pixels of the reference
+        int         incorrect;
+        double      overdraw; // fragments of the buffer per covered pixel
+        bool        failed;
+    };
+
+private:
+    ModelBase                           *_pModel; // with back faces, as dag-merger
+    std::map<int, vector<int>>           _indices; // bufferId to ordered vertex triples
+    std::map<int, vector<int>>           _triOrders; // bufferId to the triId of each triple
+    vector<int>                          _assigns; // viewId to bufferId
+    vector<Vector3d>                     _assignDirs; // viewId to direction
+
+    vector<ViewResult>                   _results;
+
+protected:
+    int chooseBuffer(const Vector3d &dir) const;
+
+public:
+    RasterVerify();
+    ~RasterVerify();
+
+    // bufferId >= 0 checks only that buffer
+    bool init(const string &modelFile, const string &cacheDir, int bufferId = -1);
+    // a view fails if more than tolerance of its covered pixels are incorrect,
+    // return the number of failed views
+    int run(int nViews, int width, int height, double nearScale, double tolerance,
+            int numThreads, int bufferId = -1);
+
+    bool saveCsv(const string &fileName) const;
+    const vector<ViewResult>& getResults() const;
+};
+
+#endif // RASTERVERIFY_H
@@ -0,0 +1,107 @@
+#include "SoftRaster.h"
+#include "dag-lib/SFMath.h"
+#include <cmath>
+#include <algorithm>
+
+// > 0 if p is left of a->b in screen space (y down)
+static inline double edge(double ax, double ay, double bx, double by, double px, double py)
+{
+    return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+// pixels exactly on an edge belong to the triangle that runs it downwards
+// (or leftwards if horizontal), the neighbor runs it the other way
+static inline bool ownsEdge(double ax, double ay, double bx, double by)
+{
+    return by > ay || (by == ay && bx < ax);
+}
+
+SoftRaster::SoftRaster(int width, int height, double fieldOfView)
+    :_width(width)
+    ,_height(height)
+    ,_focal(1.0 / tan(fieldOfView * PI / 360.0))
+    ,_fragments(0)
+{
+    _ids.resize(width * height);
+    _invDepth.resize(width * height);
+    clear();
+}
+
+void SoftRaster::setCamera(const Vector3d &eye, const Vector3d &center)
+{
+    _eye = eye;
+    _back = eye - center;
+    _back.Normalize();
+    Vector3d worldUp(0, 1, 0);
+    if (fabs(_back.Dot(worldUp)) > 0.999)
+        worldUp = Vector3d(1, 0, 0);
+    _right = worldUp.Cross(_back);
+    _right.Normalize();
+    _up = _back.Cross(_right);
+}
+
+void SoftRaster::clear()
+{
+    std::fill(_ids.begin(), _ids.end(), -1);
+    std::fill(_invDepth.begin(), _invDepth.end(), 0.0);
+    _fragments = 0;
+}
+
+bool SoftRaster::project(const Vector3d &pos, double &x, double &y, double &invDepth) const
+{
+    Vector3d d = pos - _eye;
+    double depth = -d.Dot(_back);
+    if (depth <= 1e-9)
+        return false;
+    invDepth = 1.0 / depth;
+    double aspect = (double)_width / _height;
+    x = (_focal / aspect * d.Dot(_right) * invDepth + 1.0) * 0.5 * _width;
+    y = (1.0 - _focal * d.Dot(_up) * invDepth) * 0.5 * _height;
+    return true;
+}
+
+void SoftRaster::draw(int id, const Vector3d &p0, const Vector3d &p1, const Vector3d &p2, bool depthTest)
+{
+    double x[3], y[3], iz[3];
+    if (!project(p0, x[0], y[0], iz[0]) || !project(p1, x[1], y[1], iz[1]) || !project(p2, x[2], y[2], iz[2]))
+        return;
+
+    // counter clockwise in GL is clockwise with y down
+    double area = edge(x[0], y[0], x[1], y[1], x[2], y[2]);
+    if (area >= 0)
+        return;
+    std::swap(x[1], x[2]);
+    std::swap(y[1], y[2]);
+    std::swap(iz[1], iz[2]);
+    area = -area;
+
+    bool own0 = ownsEdge(x[1], y[1], x[2], y[2]);
+    bool own1 = ownsEdge(x[2], y[2], x[0], y[0]);
+    bool own2 = ownsEdge(x[0], y[0], x[1], y[1]);
+
+    int minX = std::max(0, (int)floor(std::min(x[0], std::min(x[1], x[2]))));
+    int maxX = std::min(_width - 1, (int)ceil(std::max(x[0], std::max(x[1], x[2]))));
+    int minY = std::max(0, (int)floor(std::min(y[0], std::min(y[1], y[2]))));
+    int maxY = std::min(_height - 1, (int)ceil(std::max(y[0], std::max(y[1], y[2]))));
+    for (int py = minY; py <= maxY; ++py) {
+        double cy = py + 0.5;
+        for (int px = minX; px <= maxX; ++px) {
+            double cx = px + 0.5;
+            double w0 = edge(x[1], y[1], x[2], y[2], cx, cy);
+            double w1 = edge(x[2], y[2], x[0], y[0], cx, cy);
+            double w2 = edge(x[0], y[0], x[1], y[1], cx, cy);
+            if (w0 < 0 || w1 < 0 || w2 < 0)
+                continue;
+            if ((w0 == 0 && !own0) || (w1 == 0 && !own1) || (w2 == 0 && !own2))
+                continue;
+
+            int pix = py * _width + px;
+            double invDepth = (w0 * iz[0] + w1 * iz[1] + w2 * iz[2]) / area;
+            if (depthTest && invDepth <= _invDepth[pix])
+                continue;
+            _ids[pix] = id;
+            _invDepth[pix] = invDepth;
+            _fragments++;
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SOFTRASTER_H
+#define SOFTRASTER_H
+
+#include <vector>
+#include "dag-lib/SFVector.h"
+
+/*
+ * Minimal CPU rasterizer of triangle ids
+ *
+ * notes: a perspective camera as the one of dag-viewer (30 degree field of
+ *        view, looking at a center). Back faces are culled like
+ *        GL_CULL_FACE with counter clockwise front faces. Pixels are covered
+ *        at their centers, ties on an edge go to one side only so triangles
+ *        sharing an edge never both cover a pixel. One instance per thread.
+ */
+class SoftRaster
+{
+    int                     _width;
+    int                     _height;
+    double                  _focal; // 1 / tan(fov / 2)
+
+    Vector3d                _eye;
+    Vector3d                _right; // camera axes in world space
+    Vector3d                _up;
+    Vector3d                _back; // from the center to the eye
+
+    std::vector<int>        _ids; // pixel to triangle id, -1 if empty
+    std::vector<double>     _invDepth; // pixel to 1/depth, 0 if empty
+    long long               _fragments; // all covered pixels of draw calls
+
+    // screen position x, y and 1/depth, false if behind the near plane
+    bool project(const Vector3d &pos, double &x, double &y, double &invDepth) const;
+
+public:
+    SoftRaster(int width, int height, double fieldOfView = 30.0);
+
+    void setCamera(const Vector3d &eye, const Vector3d &center);
+    void clear();
+    // a culled triangle is skipped, with depthTest only nearer fragments are written
+    void draw(int id, const Vector3d &p0, const Vector3d &p1, const Vector3d &p2, bool depthTest);
+
+    int getWidth() const;
+    int getHeight() const;
+    const std::vector<int>& getIds() const;
+    long long getFragments() const;
+};
+
+inline int SoftRaster::getWidth() const
+{
+    return _width;
+}
+
+inline int SoftRaster::getHeight() const
+{
+    return _height;
+}
+
+inline const std::vector<int>& SoftRaster::getIds() const
+{
+    return _ids;
+}
+
+inline long long SoftRaster::getFragments() const
+{
+    return _fragments;
+}
+
+#endif // SOFTRASTER_H
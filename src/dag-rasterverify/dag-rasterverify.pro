@@ -0,0 +1,19 @@
+! include( ../app-shared.pri ) {
+    error( "Could not find the app-shared.pri file!" )
+}
+
+TARGET = dag-rasterverify
+TEMPLATE = app
+
+msvc {
+  QMAKE_CXXFLAGS += -openmp
+}
+
+SOURCES += \
+    main.cpp \
+    RasterVerify.cpp \
+    SoftRaster.cpp
+
+HEADERS += \
+    RasterVerify.h \
+    SoftRaster.h
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include "dag-lib/Log.h"
+#include "dag-lib/appcommon.h"
+#include "RasterVerify.h"
+#include "omp.h"
+
+int main(int argc, char *argv[])
+{
+    //initLogging("rasterverify");
+
+    po::variables_map vm;
+    try {
+        po::options_description app_desc("General.");
+        app_desc.add_options()
+            ("help,h", "produce help message")
+        ;
+
+        po::options_description psb_desc("trianglediag");
+        psb_desc.add_options()
+            ("model,m", po::value< std::string >(),"input model path")
+            ("sub,s", po::value< int >()->default_value(0),"Subdivide level")
+            ("innerSub,l",po::value< int >()->default_value(-1),"Defualt inner sub division level -1")
+            ("cacheRoot,c", po::value< std::string >()->default_value("./cache"),"Cache root path. default ./cache")
+            ("EpsilonPara,e", po::value< double >()->default_value(1000.0), "Epsilon over paramter. default 3000.0")
+            ("buffer,b",po::value< int >()->default_value(-1),"Check only Indices_<id>.txt from all views. Default -1 for the buffer of each view")
+            ("views,v",po::value< int >()->default_value(200),"Number of sampled views. Default 200")
+            ("width",po::value< int >()->default_value(256),"Image width. Default 256")
+            ("height",po::value< int >()->default_value(256),"Image height. Default 256")
+            ("tolerance",po::value< double >()->default_value(0.001),"Share of incorrect pixels a view may have. Default 0.001")
+            ("threads,t",po::value< int >()->default_value(0),"Number of threads. Default 0 for all cores but one")
+            ("out,o",po::value< std::string >()->default_value(""),"Result csv. Default <cache dir>/rasterverify.csv")
+            ("debug,d", po::bool_switch()->default_value(false), "show debug info")
+        ;
+
+        po::options_description cmd_desc("Command arguments");
+        cmd_desc.add(app_desc).add(psb_desc);
+        po::store(po::parse_command_line(argc, argv, cmd_desc), vm);
+        po::notify(vm);
+
+        if (vm.count("help") || !vm.count("model")) {
+            std::cout << cmd_desc << std::endl;
+            return vm.count("help") ? 0 : 1;
+        }
+    }
+    catch(std::exception& e) {
+        gLogError << "error: " << e.what();
+        return 1;
+    }
+    catch(...) {
+        gLogError << "Exception of unknown type!";
+    }
+
+    toggleDebug( vm["debug"].as<bool>() );
+
+    auto model = vm["model"].as<std::string>();
+    auto sub = vm["sub"].as<int>();
+    auto innerSub = vm["innerSub"].as<int>();
+    auto Parameter1 = vm["EpsilonPara"].as<double>();
+    std::string cacheRoot = vm["cacheRoot"].as<std::string>();
+    auto bufferId = vm["buffer"].as<int>();
+    auto nViews = vm["views"].as<int>();
+    auto width = vm["width"].as<int>();
+    auto height = vm["height"].as<int>();
+    auto tolerance = vm["tolerance"].as<double>();
+    auto numThreads = vm["threads"].as<int>();
+    if (numThreads <= 0)
+        numThreads = std::max(1, omp_get_max_threads() - 1);
+    double nearScale = 3.0;
+    if (nViews <= 0 || width <= 0 || height <= 0) {
+        gLogError << "views, width and height must be positive";
+        return 1;
+    }
+
+    std::string cacheDir = getCacheDir(cacheRoot, model, sub, Parameter1, nearScale, innerSub);
+    std::string out = vm["out"].as<std::string>();
+    if (out.empty())
+        out = cacheDir + "/rasterverify.csv";
+
+    RasterVerify verify;
+    if (!verify.init(model, cacheDir, bufferId))
+        return 1;
+    int nFailed = verify.run(nViews, width, height, nearScale, tolerance, numThreads, bufferId);
+    if (!verify.saveCsv(out))
+        return 1;
+
+    // 2 tells failed views apart from errors
+    return nFailed > 0 ? 2 : 0;
+}
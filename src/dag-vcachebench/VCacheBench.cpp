@@ -0,0 +1,407 @@
+#include "VCacheBench.h"
+#include "dag-lib/Log.h"
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <cfloat>
+
+// pixels along one side of the pass overdraw raster
+static const int PASS_RES = 128;
+
+// > 0 if p is left of a->b
+static inline double edge(double ax, double ay, double bx, double by, double px, double py)
+{
+    return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+// pixels exactly on an edge belong to one of the two triangles sharing it
+static inline bool ownsEdge(double ax, double ay, double bx, double by)
+{
+    return by > ay || (by == ay && bx < ax);
+}
+
+// column name of a cache, e.g. fifo20
+static string cacheName(VCacheSim::Policy policy, int cacheSize)
+{
+    return string(VCacheSim::policyName(policy)) + to_string(cacheSize);
+}
+
+VCacheBench::VCacheBench()
+    :_pModel(0)
+{
+}
+
+VCacheBench::~VCacheBench()
+{
+    if (_pModel)
+        delete _pModel;
+}
+
+bool VCacheBench::readInts(const string &fileName, vector<int> &values)
+{
+    values.clear();
+    std::ifstream ifs(fileName);
+    if (!ifs.is_open())
+        return false;
+    int value;
+    while (ifs >> value)
+        values.push_back(value);
+    return true;
+}
+
+bool VCacheBench::init(const string &modelFile, const string &cacheDir)
+{
+    _pModel = new ModelBase(modelFile.c_str(), true);
+
+    // load assignments
+    string fileName = cacheDir + "/assignments.txt";
+    std::ifstream ifs(fileName);
+    if (!ifs.is_open()) {
+        gLogError << "assignment file not found " << fileName;
+        return false;
+    }
+    int bufferId;
+    double theta, phi;
+    while (ifs >> bufferId >> theta >> phi) {
+        _assigns.push_back(bufferId);
+        _polars.push_back(std::make_pair(theta, phi));
+    }
+
+    // load buffers
+    int nIndices = _pModel->getNumberOfIndices();
+    for (auto id : _assigns) {
+        if (_indices.count(id))
+            continue;
+        fileName = cacheDir + "/Indices_" + to_string(id) + ".txt";
+        if (!readInts(fileName, _indices[id])) {
+            gLogError << "indice file not found " << fileName;
+            return false;
+        }
+        bool valid = (int)_indices[id].size() <= nIndices;
+        for (auto vId : _indices[id])
+            valid = valid && vId >= 0 && vId < _pModel->getNumberOfVertices();
+        if (!valid) {
+            gLogError << fileName << " doesn't match the model";
+            return false;
+        }
+        // only needed by the overdraw proxies
+        fileName = cacheDir + "/triOrder_" + to_string(id) + ".txt";
+        if (!readInts(fileName, _triOrders[id]))
+            gLogWarn << "tri order file not found " << fileName;
+        for (auto triId : _triOrders[id]) {
+            if (triId < 0 || triId >= _pModel->getNumberOfTriangles()) {
+                gLogError << fileName << " doesn't match the model";
+                return false;
+            }
+        }
+    }
+    gLogInfo << _assigns.size() << " views, " << _indices.size() << " buffers in " << cacheDir;
+    return true;
+}
+
+void VCacheBench::evalView(int viewId, ViewResult &result) const
+{
+    double theta = _polars[viewId].first;
+    double phi = _polars[viewId].second;
+    Vector3d dir(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+
+    result.viewId = viewId;
+    result.bufferId = _assigns[viewId];
+    result.theta = theta;
+    result.phi = phi;
+    result.facing = 0;
+    result.depthComplexity = 0;
+
+    const auto &triOrder = _triOrders.at(result.bufferId);
+    if (triOrder.empty())
+        return;
+    int nFacing = 0;
+    double area = 0;
+    for (auto triId : triOrder) {
+        const auto &tri = _pModel->getTriangle(triId);
+        double cosine = tri._normal.Dot(dir);
+        if (cosine <= 0)
+            continue;
+        nFacing++;
+        Vector3d edge1 = tri._vertices[1] - tri._vertices[0];
+        Vector3d edge2 = tri._vertices[2] - tri._vertices[0];
+        area += 0.5 * edge1.Cross(edge2).Len() * cosine;
+    }
+    double radius = _pModel->getRadius();
+    result.facing = (double)nFacing / triOrder.size();
+    result.depthComplexity = radius > 0 ? area / (PI * radius * radius) : 0;
+    result.passOverdraw = passOverdraw(_indices.at(result.bufferId), dir);
+}
+
+double VCacheBench::passOverdraw(const vector<int> &indices, const Vector3d &dir) const
+{
+    // orthographic camera looking at the center along -dir, the raster covers
+    // the bounding disk of the model
+    Vector3d worldUp(0, 1, 0);
+    if (fabs(dir.Dot(worldUp)) > 0.999)
+        worldUp = Vector3d(1, 0, 0);
+    Vector3d right = worldUp.Cross(dir);
+    right.Normalize();
+    Vector3d up = dir.Cross(right);
+    auto center = _pModel->getCenter3d();
+    double radius = _pModel->getRadius();
+    if (radius <= 0)
+        return 0;
+    double scale = PASS_RES / (2.0 * radius);
+
+    vector<double> depth(PASS_RES * PASS_RES, DBL_MAX);
+    long long passes = 0;
+    int covered = 0;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        double x[3], y[3], z[3];
+        for (int v = 0; v < 3; ++v) {
+            Vector3d p = _pModel->getVertexPosition3d(indices[t + v]) - center;
+            x[v] = (p.Dot(right) + radius) * scale;
+            y[v] = (p.Dot(up) + radius) * scale;
+            z[v] = -p.Dot(dir); // smaller is nearer
+        }
+        // back faces are culled, front faces are counter clockwise
+        double area = edge(x[0], y[0], x[1], y[1], x[2], y[2]);
+        if (area <= 0)
+            continue;
+        bool own0 = ownsEdge(x[1], y[1], x[2], y[2]);
+        bool own1 = ownsEdge(x[2], y[2], x[0], y[0]);
+        bool own2 = ownsEdge(x[0], y[0], x[1], y[1]);
+
+        int minX = std::max(0, (int)floor(std::min(x[0], std::min(x[1], x[2]))));
+        int maxX = std::min(PASS_RES - 1, (int)ceil(std::max(x[0], std::max(x[1], x[2]))));
+        int minY = std::max(0, (int)floor(std::min(y[0], std::min(y[1], y[2]))));
+        int maxY = std::min(PASS_RES - 1, (int)ceil(std::max(y[0], std::max(y[1], y[2]))));
+        for (int py = minY; py <= maxY; ++py) {
+            double cy = py + 0.5;
+            for (int px = minX; px <= maxX; ++px) {
+                double cx = px + 0.5;
+                double w0 = edge(x[1], y[1], x[2], y[2], cx, cy);
+                double w1 = edge(x[2], y[2], x[0], y[0], cx, cy);
+                double w2 = edge(x[0], y[0], x[1], y[1], cx, cy);
+                if (w0 < 0 || w1 < 0 || w2 < 0)
+                    continue;
+                if ((w0 == 0 && !own0) || (w1 == 0 && !own1) || (w2 == 0 && !own2))
+                    continue;
+                double d = (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area;
+                auto &pixDepth = depth[py * PASS_RES + px];
+                if (d >= pixDepth)
+                    continue;
+                if (pixDepth == DBL_MAX)
+                    covered++;
+                pixDepth = d;
+                passes++;
+            }
+        }
+    }
+    return covered ? (double)passes / covered : 0;
+}
+
+void VCacheBench::run(const vector<int> &cacheSizes)
+{
+    _bufferResults.clear();
+    for (const auto &buffer : _indices) {
+        for (auto policy : {VCacheSim::FIFO, VCacheSim::LRU}) {
+            for (auto cacheSize : cacheSizes) {
+                BufferResult result;
+                result.bufferId = buffer.first;
+                result.policy = policy;
+                result.cacheSize = cacheSize;
+                result.stats = VCacheSim::simulate(buffer.second, policy, cacheSize);
+                result.nViews = 0;
+                result.facingMean = 0;
+                result.facingMax = 0;
+                result.depthComplexityMean = 0;
+                result.depthComplexityMax = 0;
+                result.passOverdrawMean = 0;
+                result.passOverdrawMax = 0;
+                _bufferResults.push_back(result);
+            }
+        }
+    }
+
+    // views only read the model and the buffers
+    int nViews = (int)_assigns.size();
+    _viewResults.resize(nViews);
+#pragma omp parallel for schedule(dynamic,16)
+    for (int k = 0; k < nViews; k++)
+        evalView(k, _viewResults[k]);
+
+    // overdraw of a buffer over the views it serves
+    for (auto &r : _bufferResults) {
+        for (const auto &v : _viewResults) {
+            if (v.bufferId != r.bufferId)
+                continue;
+            r.nViews++;
+            r.facingMean += v.facing;
+            r.facingMax = std::max(r.facingMax, v.facing);
+            r.depthComplexityMean += v.depthComplexity;
+            r.depthComplexityMax = std::max(r.depthComplexityMax, v.depthComplexity);
+            r.passOverdrawMean += v.passOverdraw;
+            r.passOverdrawMax = std::max(r.passOverdrawMax, v.passOverdraw);
+        }
+        if (r.nViews > 0) {
+            r.facingMean /= r.nViews;
+            r.depthComplexityMean /= r.nViews;
+            r.passOverdrawMean /= r.nViews;
+        }
+    }
+}
+
+bool VCacheBench::saveCsv(const string &prefix) const
+{
+    string fileName = prefix + "_buffers.csv";
+    std::ofstream ofs(fileName);
+    if (!ofs.is_open()) {
+        gLogError << "Failed to write " << fileName;
+        return false;
+    }
+    ofs << "buffer,policy,cacheSize,tris,verts,misses,acmr,atvr,"
+        << "views,facingMean,facingMax,depthComplexityMean,depthComplexityMax,"
+        << "passOverdrawMean,passOverdrawMax" << std::endl;
+    for (const auto &r : _bufferResults)
+        ofs << r.bufferId << "," << VCacheSim::policyName(r.policy) << "," << r.cacheSize << ","
+            << r.stats.numTris << "," << r.stats.numVerts << "," << r.stats.misses << ","
+            << r.stats.acmr() << "," << r.stats.atvr() << ","
+            << r.nViews << "," << r.facingMean << "," << r.facingMax << ","
+            << r.depthComplexityMean << "," << r.depthComplexityMax << ","
+            << r.passOverdrawMean << "," << r.passOverdrawMax << std::endl;
+    ofs.close();
+    gLogInfo << "save " << fileName;
+
+    // acmr of the buffer of each view by cache, in the order of _bufferResults
+    std::map<int, vector<const BufferResult*>> byBuffer;
+    for (const auto &r : _bufferResults)
+        byBuffer[r.bufferId].push_back(&r);
+
+    fileName = prefix + "_views.csv";
+    ofs.open(fileName);
+    if (!ofs.is_open()) {
+        gLogError << "Failed to write " << fileName;
+        return false;
+    }
+    ofs << "view,buffer,theta,phi,facing,depthComplexity,passOverdraw";
+    if (!byBuffer.empty())
+        for (auto r : byBuffer.begin()->second)
+            ofs << "," << cacheName(r->policy, r->cacheSize) << "_acmr";
+    ofs << std::endl;
+    for (const auto &v : _viewResults) {
+        ofs << v.viewId << "," << v.bufferId << "," << v.theta << "," << v.phi << ","
+            << v.facing << "," << v.depthComplexity << "," << v.passOverdraw;
+        for (auto r : byBuffer[v.bufferId])
+            ofs << "," << r->stats.acmr();
+        ofs << std::endl;
+    }
+    ofs.close();
+    gLogInfo << "save " << fileName;
+    return true;
+}
+
+bool VCacheBench::saveJson(const string &fileName) const
+{
+    std::ofstream ofs(fileName);
+    if (!ofs.is_open()) {
+        gLogError << "Failed to write " << fileName;
+        return false;
+    }
+    ofs << "{\n  \"buffers\": [";
+    for (size_t i = 0; i < _bufferResults.size(); ++i) {
+        const auto &r = _bufferResults[i];
+        ofs << (i ? ",\n" : "\n") << "    {\"buffer\": " << r.bufferId
+            << ", \"policy\": \"" << VCacheSim::policyName(r.policy) << "\""
+            << ", \"cacheSize\": " << r.cacheSize
+            << ", \"tris\": " << r.stats.numTris << ", \"verts\": " << r.stats.numVerts
+            << ", \"misses\": " << r.stats.misses
+            << ", \"acmr\": " << r.stats.acmr() << ", \"atvr\": " << r.stats.atvr()
+            << ", \"views\": " << r.nViews
+            << ", \"facingMean\": " << r.facingMean << ", \"facingMax\": " << r.facingMax
+            << ", \"depthComplexityMean\": " << r.depthComplexityMean
+            << ", \"depthComplexityMax\": " << r.depthComplexityMax
+            << ", \"passOverdrawMean\": " << r.passOverdrawMean
+            << ", \"passOverdrawMax\": " << r.passOverdrawMax << "}";
+    }
+    ofs << "\n  ],\n  \"views\": [";
+    for (size_t i = 0; i < _viewResults.size(); ++i) {
+        const auto &v = _viewResults[i];
+        ofs << (i ? ",\n" : "\n") << "    {\"view\": " << v.viewId << ", \"buffer\": " << v.bufferId
+            << ", \"theta\": " << v.theta << ", \"phi\": " << v.phi
+            << ", \"facing\": " << v.facing << ", \"depthComplexity\": " << v.depthComplexity
+            << ", \"passOverdraw\": " << v.passOverdraw << "}";
+    }
+    ofs << "\n  ]\n}\n";
+    ofs.close();
+    gLogInfo << "save " << fileName;
+    return true;
+}
+
+int VCacheBench::checkBaseline(const string &fileName, double threshold) const
+{
+    std::ifstream ifs(fileName);
+    if (!ifs.is_open()) {
+        gLogError << "baseline not found " << fileName;
+        return -1;
+    }
+    // buffer,policy,cacheSize,tris,verts,misses,acmr,atvr
+    //   [,views,facingMean,facingMax,depthComplexityMean,depthComplexityMax,passOverdrawMean,...]
+    std::map<string, double> baseAcmr;
+    std::map<int, double> basePassOverdraw; // older baselines don't have it
+    string line;
+    std::getline(ifs, line);
+    while (std::getline(ifs, line)) {
+        std::istringstream iss(line);
+        vector<string> fields;
+        string field;
+        while (std::getline(iss, field, ','))
+            fields.push_back(field);
+        if (fields.size() < 8)
+            continue;
+        baseAcmr[fields[0] + "," + fields[1] + fields[2]] = std::atof(fields[6].c_str());
+        if (fields.size() >= 14)
+            basePassOverdraw[std::atoi(fields[0].c_str())] = std::atof(fields[13].c_str());
+    }
+
+    int nRegressions = 0;
+    int nCompared = 0;
+    for (const auto &r : _bufferResults) {
+        string cache = cacheName(r.policy, r.cacheSize);
+        auto it = baseAcmr.find(to_string(r.bufferId) + "," + cache);
+        if (it == baseAcmr.end())
+            continue;
+        nCompared++;
+        if (r.stats.acmr() > it->second * (1.0 + threshold) + 1e-6) {
+            gLogError << "buffer " << r.bufferId << " " << cache << " acmr "
+                      << it->second << " -> " << r.stats.acmr();
+            nRegressions++;
+        }
+    }
+
+    // the order of a buffer is the same for all caches, so it's checked once
+    std::map<int, double> passOverdraw;
+    for (const auto &r : _bufferResults)
+        passOverdraw[r.bufferId] = r.passOverdrawMean;
+    for (const auto &buffer : passOverdraw) {
+        auto it = basePassOverdraw.find(buffer.first);
+        if (it == basePassOverdraw.end())
+            continue;
+        nCompared++;
+        if (buffer.second > it->second * (1.0 + threshold) + 1e-6) {
+            gLogError << "buffer " << buffer.first << " pass overdraw "
+                      << it->second << " -> " << buffer.second;
+            nRegressions++;
+        }
+    }
+    gLogInfo << nRegressions << " regressions in " << nCompared << " compared buffer results";
+    return nRegressions;
+}
+
+const vector<VCacheBench::BufferResult>& VCacheBench::getBufferResults() const
+{
+    return _bufferResults;
+}
+
+const vector<VCacheBench::ViewResult>& VCacheBench::getViewResults() const
+{
+    return _viewResults;
+}
@@ -0,0 +1,90 @@
+#ifndef VCACHEBENCH_H
+#define VCACHEBENCH_H
+
+#include <string>
+#include <map>
+#include "dag-lib/ModelBase.h"
+#include "dag-lib/VCacheSim.h"
+
+/*
+ * Simulated post-transform cache benchmark of the buffers of a cache dir
+ *
+ * notes: every buffer (Indices_<id>.txt, triOrder_<id>.txt) is run through
+ *        FIFO and LRU caches of each size. Views of assignments.txt get the
+ *        results of their buffer plus overdraw proxies under an orthographic
+ *        projection along the view direction. The share of buffer triangles
+ *        facing the view and the depth complexity, the projected area of
+ *        those triangles over the area of the bounding disk of the model, are
+ *        order independent. Pass overdraw depends on the order: the facing
+ *        triples of the index buffer are rasterized in order with a depth
+ *        test and it counts the fragments that pass per covered pixel. It is
+ *        1 front to back and the depth complexity of the raster back to
+ *        front, as in-depth buffers are meant for drawing without depth
+ *        test. Buffer results carry the mean and max of the proxies over
+ *        their views.
+ */
+class VCacheBench
+{
+public:
+    struct BufferResult
+    {
+        int                 bufferId;
+        VCacheSim::Policy   policy;
+        int                 cacheSize;
+        VCacheSim::Stats    stats;
+        // overdraw proxies over the views assigned to the buffer, 0 without views
+        int                 nViews;
+        double              facingMean;
+        double              facingMax;
+        double              depthComplexityMean;
+        double              depthComplexityMax;
+        double              passOverdrawMean;
+        double              passOverdrawMax;
+    };
+
+    struct ViewResult
+    {
+        int                 viewId;
+        int                 bufferId;
+        double              theta;
+        double              phi;
+        double              facing; // share of buffer tris facing the view, order independent
+        double              depthComplexity; // order independent
+        double              passOverdraw; // depth test passes per covered pixel, order dependent
+    };
+
+private:
+    ModelBase                           *_pModel; // with back faces, as dag-merger
+    std::map<int, vector<int>>           _indices; // bufferId to ordered indices
+    std::map<int, vector<int>>           _triOrders; // bufferId to ordered triIds
+    vector<int>                          _assigns; // viewId to bufferId
+    vector<std::pair<double,double>>     _polars; // viewId to theta, phi
+
+    vector<BufferResult>                 _bufferResults;
+    vector<ViewResult>                   _viewResults;
+
+protected:
+    static bool readInts(const string &fileName, vector<int> &values);
+    void evalView(int viewId, ViewResult &result) const;
+    // depth test passes per covered pixel of the facing triples of indices, in order
+    double passOverdraw(const vector<int> &indices, const Vector3d &dir) const;
+
+public:
+    VCacheBench();
+    ~VCacheBench();
+
+    bool init(const string &modelFile, const string &cacheDir);
+    void run(const vector<int> &cacheSizes);
+
+    bool saveCsv(const string &prefix) const; // prefix_buffers.csv and prefix_views.csv
+    bool saveJson(const string &fileName) const;
+    // buffer results that have an acmr or a mean pass overdraw above the one in
+    // baseline (a buffers csv) by more than threshold relative, -1 if baseline
+    // can't be read
+    int checkBaseline(const string &fileName, double threshold) const;
+
+    const vector<BufferResult>& getBufferResults() const;
+    const vector<ViewResult>& getViewResults() const;
+};
+
+#endif // VCACHEBENCH_H
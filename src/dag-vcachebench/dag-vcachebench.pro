@@ -0,0 +1,17 @@
+! include( ../app-shared.pri ) {
+    error( "Could not find the app-shared.pri file!" )
+}
+
+TARGET = dag-vcachebench
+TEMPLATE = app
+
+msvc {
+  QMAKE_CXXFLAGS += -openmp
+}
+
+SOURCES += \
+    main.cpp \
+    VCacheBench.cpp
+
+HEADERS += \
+    VCacheBench.h
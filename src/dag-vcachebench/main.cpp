@@ -0,0 +1,106 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include "dag-lib/Log.h"
+#include "dag-lib/appcommon.h"
+#include "VCacheBench.h"
+
+int main(int argc, char *argv[])
+{
+    //initLogging("vcachebench");
+
+    po::variables_map vm;
+    try {
+        po::options_description app_desc("General.");
+        app_desc.add_options()
+            ("help,h", "produce help message")
+        ;
+
+        po::options_description psb_desc("trianglediag");
+        psb_desc.add_options()
+            ("model,m", po::value< std::string >(),"input model path")
+            ("sub,s", po::value< int >()->default_value(0),"Subdivide level")
+            ("innerSub,l",po::value< int >()->default_value(-1),"Defualt inner sub division level -1")
+            ("cacheRoot,c", po::value< std::string >()->default_value("./cache"),"Cache root path. default ./cache")
+            ("EpsilonPara,e", po::value< double >()->default_value(1000.0), "Epsilon over paramter. default 3000.0")
+            ("cacheSizes",po::value< std::string >()->default_value("16,20,32"),"Comma separated cache sizes. Default 16,20,32")
+            ("out,o",po::value< std::string >()->default_value(""),"Output prefix. Default <cache dir>/vcachebench")
+            ("format",po::value< std::string >()->default_value("both"),"csv, json or both. Default both")
+            ("baseline",po::value< std::string >()->default_value(""),"Buffers csv of an earlier run, fail on acmr or pass overdraw regressions")
+            ("threshold",po::value< double >()->default_value(0.01),"Allowed relative acmr and pass overdraw increase over the baseline. Default 0.01")
+            ("debug,d", po::bool_switch()->default_value(false), "show debug info")
+        ;
+
+        po::options_description cmd_desc("Command arguments");
+        cmd_desc.add(app_desc).add(psb_desc);
+        po::store(po::parse_command_line(argc, argv, cmd_desc), vm);
+        po::notify(vm);
+
+        if (vm.count("help") || !vm.count("model")) {
+            std::cout << cmd_desc << std::endl;
+            return vm.count("help") ? 0 : 1;
+        }
+    }
+    catch(std::exception& e) {
+        gLogError << "error: " << e.what();
+        return 1;
+    }
+    catch(...) {
+        gLogError << "Exception of unknown type!";
+    }
+
+    toggleDebug( vm["debug"].as<bool>() );
+
+    auto model = vm["model"].as<std::string>();
+    auto sub = vm["sub"].as<int>();
+    auto innerSub = vm["innerSub"].as<int>();
+    auto Parameter1 = vm["EpsilonPara"].as<double>();
+    std::string cacheRoot = vm["cacheRoot"].as<std::string>();
+    auto format = vm["format"].as<std::string>();
+    auto baseline = vm["baseline"].as<std::string>();
+    auto threshold = vm["threshold"].as<double>();
+    double nearScale = 3.0;
+
+    std::vector<int> cacheSizes;
+    std::istringstream sizes(vm["cacheSizes"].as<std::string>());
+    std::string size;
+    while (std::getline(sizes, size, ',')) {
+        int cacheSize = std::atoi(size.c_str());
+        if (cacheSize <= 0) {
+            gLogError << "invalid cache size " << size;
+            return 1;
+        }
+        cacheSizes.push_back(cacheSize);
+    }
+    if (format != "csv" && format != "json" && format != "both") {
+        gLogError << "unknown format " << format;
+        return 1;
+    }
+
+    std::string cacheDir = getCacheDir(cacheRoot, model, sub, Parameter1, nearScale, innerSub);
+    std::string out = vm["out"].as<std::string>();
+    if (out.empty())
+        out = cacheDir + "/vcachebench";
+
+    VCacheBench bench;
+    if (!bench.init(model, cacheDir))
+        return 1;
+    bench.run(cacheSizes);
+
+    if (format != "json" && !bench.saveCsv(out))
+        return 1;
+    if (format != "csv" && !bench.saveJson(out + ".json"))
+        return 1;
+
+    // 2 tells regressions apart from failures
+    if (!baseline.empty()) {
+        int nRegressions = bench.checkBaseline(baseline, threshold);
+        if (nRegressions < 0)
+            return 1;
+        if (nRegressions > 0)
+            return 2;
+    }
+    return 0;
+}
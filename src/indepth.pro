@@ -7,7 +7,15 @@ SUBDIRS = \
     dag-lib \
     dag-merger \
     dag-upsample \
+    dag-vcachebench \
+    dag-rasterverify \
     dag-viewer
 
 dag-merger.depends = \
     dag-lib
+
+dag-vcachebench.depends = \
+    dag-lib
+
+dag-rasterverify.depends = \
+    dag-lib